@@ -4,12 +4,52 @@
 #include "ASTVisitor.h"
 #include "ASTNodeDefinitions.h"
 #include "Token.h"
+#include "StructuralHash.h"
+
+#define DECLARE_AST_NODE_KIND(NAME, PROPERTIES) NAME,
+
+enum class ASTNodeKind {
+    AST_NODES_LIST(DECLARE_AST_NODE_KIND)
+};
 
 struct ASTNode {
+    explicit ASTNode(ASTNodeKind kind)
+        : m_Kind(kind)
+    {}
+
+    ASTNodeKind GetKind() const {
+        return m_Kind;
+    }
+
     virtual const char* GetNodeName() const = 0;
 
     virtual void Accept(ASTVisitor& visitor) = 0;
     virtual void Accept(ASTVisitor&& visitor) = 0;
+
+    // Computed bottom-up when the node is constructed. Passes that rewrite
+    // a tree in place call UpdateStructuralHashes() on it afterwards.
+    const StructuralHash& GetStructuralHash() const {
+        return m_StructuralHash;
+    }
+
+    virtual void UpdateStructuralHash() = 0;
+
+    // Where the node starts in the source. Only the parser sets it, and only
+    // on function declarations; everything else stays at 0:0.
+    const Location& GetLocation() const {
+        return m_Location;
+    }
+
+    void SetLocation(Location location) {
+        m_Location = location;
+    }
+
+protected:
+    StructuralHash m_StructuralHash;
+
+private:
+    ASTNodeKind m_Kind;
+    Location m_Location{};
 };
 
 struct FuncParam {
@@ -17,23 +57,145 @@ struct FuncParam {
     String type;
 };
 
+// Filled in by NameResolver. depth counts the scopes between the use and the
+// declaring scope (0 = innermost); slot is the local's index in that scope or
+// the parameter's index in its function.
+struct NameBinding {
+    enum class Kind {
+        Unresolved,
+        Local,
+        Parameter,
+    };
+
+    Kind kind = Kind::Unresolved;
+    int depth = 0;
+    int slot = 0;
+};
+
+// Filled in by TypeChecker with the integer type a literal's context gives
+// it. Empty until then; a literal nothing constrains is an i32.
+struct LiteralType {
+    String name;
+};
+
 using ASTNodeRef = SharedPtr<ASTNode>;
 
+inline void HashProperty(StructuralHasher& hasher, int value) {
+    hasher.Add((uint64_t)(uint32_t)value);
+}
+
+inline void HashProperty(StructuralHasher& hasher, TokenType value) {
+    hasher.Add((uint64_t)value);
+}
+
+inline void HashProperty(StructuralHasher& hasher, const String& value) {
+    hasher.Add(std::string_view(value));
+}
+
+inline void HashProperty(StructuralHasher& hasher, const ASTNodeRef& child) {
+    if (child) {
+        hasher.Add(child->GetStructuralHash());
+    } else {
+        hasher.Add(~0ull);
+    }
+}
+
+inline void HashProperty(StructuralHasher& hasher, const Vector<ASTNodeRef>& children) {
+    hasher.Add((uint64_t)children.size());
+    for (const auto& child : children) {
+        HashProperty(hasher, child);
+    }
+}
+
+inline void HashProperty(StructuralHasher& hasher, const Vector<FuncParam>& params) {
+    hasher.Add((uint64_t)params.size());
+    for (const auto& param : params) {
+        hasher.Add(std::string_view(param.name));
+        hasher.Add(std::string_view(param.type));
+    }
+}
+
+// Bindings are filled in later by NameResolver, so they aren't part of
+// the structure
+inline void HashProperty(StructuralHasher&, const NameBinding&) {}
+
+// Likewise filled in later, by TypeChecker
+inline void HashProperty(StructuralHasher&, const LiteralType&) {}
+
+// Destroying a deep tree through nested shared_ptr destructors would recurse
+// once per level. Node destructors instead hand their children to a per-thread
+// queue which the outermost destructor drains in a loop.
+struct ASTNodeReleaser {
+    static void Release(ASTNodeRef& child) {
+        if (child) {
+            GetPending().push_back(std::move(child));
+        }
+    }
+
+    static void Release(Vector<ASTNodeRef>& children) {
+        for (auto& child : children) {
+            Release(child);
+        }
+    }
+
+    template <typename T>
+    static void Release(T&) {}
+
+    static void Drain() {
+        thread_local bool draining = false;
+        if (draining) {
+            return;
+        }
+
+        draining = true;
+        auto& pending = GetPending();
+        while (!pending.empty()) {
+            ASTNodeRef node = std::move(pending.back());
+            pending.pop_back();
+        }
+        draining = false;
+    }
+
+private:
+    static Vector<ASTNodeRef>& GetPending() {
+        thread_local Vector<ASTNodeRef> pending;
+        return pending;
+    }
+};
+
 #define GENERATE_FIELDS(TYPE, NAME) TYPE m_##NAME;
 
 #define EXPAND_INIT_PARAMETERS(TYPE, NAME) const TYPE& NAME,
 #define EXPAND_INIT_LIST(TYPE, NAME) m_##NAME(NAME),
 
+#define RELEASE_PROPERTY(TYPE, NAME) ASTNodeReleaser::Release(m_##NAME);
+
 #define DEFINE_PROPERTY_GETTERS(TYPE, NAME) \
     TYPE& Get##NAME() { return m_##NAME; }
 
 #define DEFINE_PROPERTY_GETTERS_CONST(TYPE, NAME) \
     const TYPE& Get##NAME() const { return m_##NAME; }
 
+#define HASH_PROPERTY(TYPE, NAME) HashProperty(hasher, m_##NAME);
+
 #define DEFINE_AST_NODES(NAME, PROPERTIES)                                   \
     struct NAME final : public ASTNode {                                     \
         explicit NAME(PROPERTIES(EXPAND_INIT_PARAMETERS) bool dummy = false) \
-            : PROPERTIES(EXPAND_INIT_LIST) m_Dummy(dummy) {}                 \
+            : ASTNode(ASTNodeKind::NAME),                                    \
+              PROPERTIES(EXPAND_INIT_LIST) m_Dummy(dummy) {                  \
+            NAME::UpdateStructuralHash();                                    \
+        }                                                                    \
+                                                                             \
+        void UpdateStructuralHash() override {                               \
+            StructuralHasher hasher((uint64_t)ASTNodeKind::NAME);            \
+            PROPERTIES(HASH_PROPERTY)                                        \
+            m_StructuralHash = hasher.Finish();                              \
+        }                                                                    \
+                                                                             \
+        ~NAME() {                                                            \
+            PROPERTIES(RELEASE_PROPERTY);                                    \
+            ASTNodeReleaser::Drain();                                        \
+        }                                                                    \
                                                                              \
         virtual void Accept(ASTVisitor& visitor) override {                  \
             visitor.Visit(*this);                                            \
@@ -55,3 +217,9 @@ using ASTNodeRef = SharedPtr<ASTNode>;
 
 AST_NODES_LIST(DEFINE_AST_NODES);
 
+#define DEFINE_NODE_KIND_NAMES(NAME, PROPERTIES) \
+    template <>                                  \
+    inline const char* MemStats::NodeKindName<NAME> = #NAME;
+
+AST_NODES_LIST(DEFINE_NODE_KIND_NAMES);
+
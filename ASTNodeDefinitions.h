@@ -8,7 +8,8 @@
 #define FOR_STATEMENT_PROPERTIES(MACRO) \
     MACRO(ASTNodeRef, Initialization) \
     MACRO(ASTNodeRef, Condition)      \
-    MACRO(ASTNodeRef, Increment)
+    MACRO(ASTNodeRef, Increment)      \
+    MACRO(ASTNodeRef, Body)
 
 #define FUNCTION_DECLARATION_PROPERTIES(MACRO) \
     MACRO(String, Name)                        \
@@ -21,16 +22,22 @@
     MACRO(ASTNodeRef, InitialValue)
 
 #define INTEGER_LITERAL_EXPRESSION_PROPERTIES(MACRO) \
-    MACRO(int, Value)
+    MACRO(int, Value)                               \
+    MACRO(LiteralType, Type)
 
 #define IDENTIFIER_EXPRESSION_PROPERTIES(MACRO) \
-    MACRO(String, Name)
+    MACRO(String, Name)                         \
+    MACRO(NameBinding, Binding)
 
 #define BINARY_EXPRESSION_PROPERTIES(MACRO) \
     MACRO(TokenType, Operator)              \
     MACRO(ASTNodeRef, Left)                 \
     MACRO(ASTNodeRef, Right)
 
+#define ASSIGNMENT_EXPRESSION_PROPERTIES(MACRO) \
+    MACRO(ASTNodeRef, Target)                   \
+    MACRO(ASTNodeRef, Value)
+
 #define AST_NODES_LIST(MACRO)                                              \
     MACRO(TopStatements, TOP_STATEMENTS_PROPERTIES)                        \
     MACRO(ForStatement, FOR_STATEMENT_PROPERTIES)                          \
@@ -38,5 +45,6 @@
     MACRO(VariableDeclaration, VARIABLE_DECLARATION_PROPERTIES)            \
     MACRO(IntegerLiteralExpression, INTEGER_LITERAL_EXPRESSION_PROPERTIES) \
     MACRO(IdentifierExpression, IDENTIFIER_EXPRESSION_PROPERTIES)          \
-    MACRO(BinaryExpression, BINARY_EXPRESSION_PROPERTIES)
+    MACRO(BinaryExpression, BINARY_EXPRESSION_PROPERTIES)                  \
+    MACRO(AssignmentExpression, ASSIGNMENT_EXPRESSION_PROPERTIES)
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+
+#include <algorithm>
+
+namespace ASTWalker
+{
+    template <typename Func>
+    void ForEachChildIn(ASTNodeRef& child, Func&& func) {
+        if (child) {
+            func(child);
+        }
+    }
+
+    template <typename Func>
+    void ForEachChildIn(Vector<ASTNodeRef>& children, Func&& func) {
+        for (auto& child : children) {
+            ForEachChildIn(child, func);
+        }
+    }
+
+    template <typename T, typename Func>
+    void ForEachChildIn(T&, Func&&) {}
+
+#define FOR_EACH_CHILD_PROPERTY(TYPE, NAME) ForEachChildIn(typed.Get##NAME(), func);
+
+#define FOR_EACH_CHILD_CASE(NAME, PROPERTIES)   \
+    case ASTNodeKind::NAME: {                   \
+        auto& typed = static_cast<NAME&>(node); \
+        (void)typed;                            \
+        PROPERTIES(FOR_EACH_CHILD_PROPERTY)     \
+        break;                                  \
+    }
+
+    // Calls func(ASTNodeRef&) for every direct child of node, in property order
+    template <typename Func>
+    void ForEachChild(ASTNode& node, Func&& func) {
+        switch (node.GetKind()) {
+            AST_NODES_LIST(FOR_EACH_CHILD_CASE)
+        }
+    }
+
+#undef FOR_EACH_CHILD_PROPERTY
+#undef FOR_EACH_CHILD_CASE
+
+    // Depth-first walk over an explicit heap-allocated stack, so arbitrarily
+    // deep trees are traversed in bounded native stack. enter(ASTNode&) is
+    // called in pre-order and returns false to skip the node's children;
+    // leave(ASTNode&) is called in post-order.
+    template <typename Enter, typename Leave>
+    void Walk(const ASTNodeRef& root, Enter&& enter, Leave&& leave) {
+        struct Frame {
+            ASTNode* node;
+            bool leaving;
+        };
+
+        if (!root) {
+            return;
+        }
+
+        Vector<Frame> stack;
+        stack.push_back(Frame{ root.get(), false });
+
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+
+            if (frame.leaving) {
+                leave(*frame.node);
+                continue;
+            }
+
+            stack.push_back(Frame{ frame.node, true });
+            if (!enter(*frame.node)) {
+                continue;
+            }
+
+            // Children are pushed in reverse so they pop in property order
+            const size_t firstChild = stack.size();
+            ForEachChild(*frame.node, [&](ASTNodeRef& child) {
+                stack.push_back(Frame{ child.get(), false });
+            });
+            std::reverse(stack.begin() + firstChild, stack.end());
+        }
+    }
+
+    template <typename Func>
+    void ForEachNode(const ASTNodeRef& root, Func&& func) {
+        Walk(root,
+            [&](ASTNode& node) { func(node); return true; },
+            [](ASTNode&) {});
+    }
+
+    // Recomputes structural hashes bottom-up after a pass rewrote the tree
+    inline void UpdateStructuralHashes(const ASTNodeRef& root) {
+        Walk(root,
+            [](ASTNode&) { return true; },
+            [](ASTNode& node) { node.UpdateStructuralHash(); });
+    }
+}
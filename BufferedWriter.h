@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+// Output through one large buffer and a single fwrite per fill, instead of
+// an iostream call per token. Flushed on destruction.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(FILE* file, size_t capacity = 1 << 20)
+        : m_File(file), m_Buffer(new char[capacity]), m_Capacity(capacity)
+    {}
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    ~BufferedWriter() {
+        Flush();
+    }
+
+    void Put(char c) {
+        if (m_Size == m_Capacity) {
+            Flush();
+        }
+        m_Buffer[m_Size++] = c;
+    }
+
+    void Write(const char* data, size_t size) {
+        if (size > m_Capacity - m_Size) {
+            Flush();
+            if (size > m_Capacity) {
+                std::fwrite(data, 1, size, m_File);
+                return;
+            }
+        }
+        std::memcpy(m_Buffer.get() + m_Size, data, size);
+        m_Size += size;
+    }
+
+    void Repeat(char c, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            Put(c);
+        }
+    }
+
+    void Flush() {
+        if (m_Size > 0) {
+            std::fwrite(m_Buffer.get(), 1, m_Size, m_File);
+            m_Size = 0;
+        }
+    }
+
+private:
+    FILE* m_File;
+    std::unique_ptr<char[]> m_Buffer;
+    size_t m_Capacity;
+    size_t m_Size = 0;
+};
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "StaticASTVisitor.h"
+#include "TypeTable.h"
+#include "Token.h"
+
+#include <cctype>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Ahead-of-time backend: emits one C99 translation unit for a name-resolved
+// AST. Builtin integer types map to <stdint.h> types and arithmetic goes
+// through zix_<op>_<type> helpers with defined results where C has none:
+// + - * wrap around, division by zero yields 0 and MIN / -1 yields MIN.
+// Locals are named <name>_<scope>_<slot>, so shadowing never depends on C's
+// scoping rules. Top-level lets become statics set up by zix_init(), and
+// functions are emitted as zix_<name>. zix has no return statement yet, so
+// functions return the zero value of their return type.
+class CEmitterVisitor final : public StaticASTVisitor<CEmitterVisitor> {
+public:
+    using StaticASTVisitor::Visit;
+
+    CEmitterVisitor(TypeTable& types, std::ostream& output = std::cout)
+        : m_Types(types), m_Output(output)
+    {}
+
+    void Visit(const TopStatements& node) {
+        if (m_Scopes.empty()) {
+            EmitTranslationUnit(node);
+            return;
+        }
+
+        m_Scopes.emplace_back();
+        for (const auto& stat : node.GetStatements()) {
+            Dispatch(stat);
+        }
+        m_Scopes.pop_back();
+    }
+
+    void Visit(const VariableDeclaration& node) {
+        Indent();
+
+        // The initializer can't see the new binding, so emit it first
+        std::ostringstream initializer;
+        const Type* type = EmitExpressionTo(initializer, node.GetInitialValue());
+        const String name = Declare(node.GetName(), type);
+        m_Output << GetCType(type) << ' ' << name << " = " << initializer.str() << ";\n";
+    }
+
+    void Visit(const ForStatement& node) {
+        m_Scopes.emplace_back();
+
+        auto& init = static_cast<const VariableDeclaration&>(*node.GetInitialization());
+        std::ostringstream initializer;
+        const Type* type = EmitExpressionTo(initializer, init.GetInitialValue());
+        const String name = Declare(init.GetName(), type);
+
+        Indent();
+        m_Output << "for (" << GetCType(type) << ' ' << name << " = " << initializer.str() << "; ";
+        EmitExpression(node.GetCondition());
+        m_Output << "; ";
+        EmitExpression(node.GetIncrement());
+        m_Output << ") {\n";
+
+        ++m_IndentLevel;
+        Dispatch(node.GetBody());
+        --m_IndentLevel;
+        Indent();
+        m_Output << "}\n";
+
+        m_Scopes.pop_back();
+    }
+
+    void Visit(const FunctionDeclaration& node) {
+        if (m_InFunction) {
+            m_Errors.push_back("nested fn " + node.GetName() + " is not supported");
+            return;
+        }
+
+        m_InFunction = true;
+        m_Scopes.emplace_back();
+        EmitSignature(node);
+        m_Output << " {\n";
+
+        ++m_IndentLevel;
+        Dispatch(node.GetBody());
+        Indent();
+        // Until zix has a return statement every function yields the zero
+        // value of its return type, whatever its body computes
+        m_Output << "return " << GetZeroValue(ResolveType(node.GetReturnType()))
+                 << "; /* zix has no return statement yet */\n";
+        --m_IndentLevel;
+
+        m_Output << "}\n\n";
+        m_Scopes.pop_back();
+        m_InFunction = false;
+    }
+
+    void Visit(const IntegerLiteralExpression& node) {
+        const Type* type = m_Types.GetLiteralType(node.GetType().name);
+        m_Output << (type->isSigned ? "INT" : "UINT") << type->bitWidth << "_C(" << node.GetValue() << ")";
+        m_LastType = type;
+    }
+
+    void Visit(const IdentifierExpression& node) {
+        const NameBinding& binding = node.GetBinding();
+        const int scopeIndex = (int)m_Scopes.size() - 1 - binding.depth;
+        if (binding.kind == NameBinding::Kind::Unresolved || scopeIndex < 0 ||
+            binding.slot >= (int)m_Scopes[scopeIndex].size()) {
+            m_Errors.push_back("unresolved name " + node.GetName());
+            m_Output << "0 /* " << Mangle(node.GetName()) << " */";
+            m_LastType = m_Types.GetError();
+            return;
+        }
+
+        m_Output << LocalName(node.GetName(), scopeIndex, binding.slot);
+        m_LastType = m_Scopes[scopeIndex][binding.slot];
+    }
+
+    void Visit(const BinaryExpression& node) {
+        const TokenType op = node.GetOperator();
+        if (op == TokenType::LESS || op == TokenType::GREATER) {
+            m_Output << '(';
+            Dispatch(node.GetLeft());
+            m_Output << (op == TokenType::LESS ? " < " : " > ");
+            Dispatch(node.GetRight());
+            m_Output << ')';
+            m_LastType = m_Types.Lookup("bool");
+            return;
+        }
+
+        // Operand types were checked by TypeChecker; the left one decides
+        std::ostringstream left;
+        const Type* type = EmitExpressionTo(left, node.GetLeft());
+        if (!type->IsInteger()) {
+            type = m_Types.Lookup("i32");
+        }
+
+        m_Output << "zix_" << GetHelperName(op) << '_' << type->name << '(' << left.str() << ", ";
+        Dispatch(node.GetRight());
+        m_Output << ')';
+        m_LastType = type;
+    }
+
+    void Visit(const AssignmentExpression& node) {
+        Dispatch(node.GetTarget());
+        const Type* type = m_LastType;
+        m_Output << " = ";
+        Dispatch(node.GetValue());
+        m_LastType = type;
+    }
+
+    const Vector<String>& GetErrors() const {
+        return m_Errors;
+    }
+
+    void DumpErrors(std::ostream& out = std::cerr) const {
+        for (const auto& error : m_Errors) {
+            out << "C backend: " << error << std::endl;
+        }
+    }
+
+private:
+    void EmitTranslationUnit(const TopStatements& root) {
+        EmitPrelude();
+
+        // Scope 0 is the top level: its lets are statics and its other
+        // statements run in zix_init()
+        m_Scopes.emplace_back();
+        std::ostringstream init;
+        for (const auto& stat : root.GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::FunctionDeclaration) {
+                EmitSignature(static_cast<const FunctionDeclaration&>(*stat));
+                m_Output << ";\n";
+            }
+        }
+        m_Output << '\n';
+
+        ++m_IndentLevel;
+        for (const auto& stat : root.GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::VariableDeclaration) {
+                auto& decl = static_cast<const VariableDeclaration&>(*stat);
+                std::ostringstream initializer;
+                const Type* type = EmitExpressionTo(initializer, decl.GetInitialValue());
+                const String name = Declare(decl.GetName(), type);
+                m_Output << "static " << GetCType(type) << ' ' << name << ";\n";
+                init << "    " << name << " = " << initializer.str() << ";\n";
+            } else if (stat->GetKind() == ASTNodeKind::ForStatement) {
+                WithOutput(init, [&] { Dispatch(stat); });
+            }
+        }
+        --m_IndentLevel;
+
+        m_Output << "\nvoid zix_init(void) {\n" << init.str() << "}\n\n";
+
+        for (const auto& stat : root.GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::FunctionDeclaration) {
+                Dispatch(stat);
+            }
+        }
+        m_Scopes.pop_back();
+    }
+
+    void EmitPrelude() {
+        m_Output << "/* Generated from zix. */\n";
+        m_Output << "#include <stdbool.h>\n#include <stdint.h>\n\n";
+
+#define EMIT_INTEGER_HELPERS(NAME, KIND, BITS, SIGNED) \
+        if (Type::Kind::KIND == Type::Kind::Integer) EmitIntegerHelpers(NAME, BITS, SIGNED);
+
+        BUILTIN_TYPE_LIST(EMIT_INTEGER_HELPERS)
+#undef EMIT_INTEGER_HELPERS
+        m_Output << '\n';
+    }
+
+    void EmitIntegerHelpers(const char* name, int bits, bool isSigned) {
+        const String type = String(isSigned ? "int" : "uint") + std::to_string(bits).c_str() + "_t";
+        // Arithmetic is done on an unsigned type at least as wide as int, so
+        // neither signed overflow nor integer promotion can make it undefined
+        const char* wide = bits == 64 ? "uint64_t" : "uint32_t";
+
+        static const char* const ops[][2] = { { "add", "+" }, { "sub", "-" }, { "mul", "*" } };
+        for (const auto& op : ops) {
+            m_Output << "static inline " << type << " zix_" << op[0] << '_' << name << '(' << type << " a, " << type
+                     << " b) { return (" << type << ")((" << wide << ")a " << op[1] << " (" << wide << ")b); }\n";
+        }
+
+        m_Output << "static inline " << type << " zix_div_" << name << '(' << type << " a, " << type << " b) { ";
+        if (isSigned) {
+            m_Output << "return b == 0 ? 0 : (b == -1 ? zix_sub_" << name << "(0, a) : a / b); }\n";
+        } else {
+            m_Output << "return b == 0 ? 0 : a / b; }\n";
+        }
+    }
+
+    void EmitSignature(const FunctionDeclaration& node) {
+        m_Output << GetCType(ResolveType(node.GetReturnType())) << " zix_" << Mangle(node.GetName()) << '(';
+
+        const bool declaring = m_InFunction;
+        const auto& params = node.GetParameters();
+        if (params.empty()) {
+            m_Output << "void";
+        }
+        for (size_t i = 0; i < params.size(); ++i) {
+            const Type* type = ResolveType(params[i].type);
+            m_Output << (i ? ", " : "") << GetCType(type) << ' ';
+            m_Output << (declaring ? Declare(params[i].name, type) : Mangle(params[i].name));
+        }
+        m_Output << ')';
+    }
+
+    void EmitExpression(const ASTNodeRef& expr) {
+        Dispatch(expr);
+    }
+
+    // Emits expr into a side buffer and returns its type
+    const Type* EmitExpressionTo(std::ostringstream& buffer, const ASTNodeRef& expr) {
+        WithOutput(buffer, [&] { Dispatch(expr); });
+        return m_LastType;
+    }
+
+    template <typename Func>
+    void WithOutput(std::ostream& output, Func&& func) {
+        std::streambuf* previous = m_Output.rdbuf(output.rdbuf());
+        func();
+        m_Output.rdbuf(previous);
+    }
+
+    String Declare(const String& name, const Type* type) {
+        auto& scope = m_Scopes.back();
+        scope.push_back(type);
+        return LocalName(name, (int)m_Scopes.size() - 1, (int)scope.size() - 1);
+    }
+
+    static String LocalName(const String& name, int scope, int slot) {
+        return Mangle(name) + "_" + std::to_string(scope).c_str() + "_" + std::to_string(slot).c_str();
+    }
+
+    // Generated names such as $licm0 and UTF-8 identifiers aren't valid C
+    // identifiers; other bytes are written as _XX so distinct names stay distinct
+    static String Mangle(const String& name) {
+        static const char hexDigits[] = "0123456789ABCDEF";
+        String mangled;
+        for (char c : name) {
+            const unsigned char byte = (unsigned char)c;
+            if (byte < 0x80 && std::isalnum(byte)) {
+                mangled += c;
+            } else {
+                mangled += '_';
+                mangled += hexDigits[byte >> 4];
+                mangled += hexDigits[byte & 0xF];
+            }
+        }
+        return mangled;
+    }
+
+    static const char* GetHelperName(TokenType op) {
+        switch (op) {
+            case TokenType::PLUS: return "add";
+            case TokenType::MINUS: return "sub";
+            case TokenType::STAR: return "mul";
+            default: return "div";
+        }
+    }
+
+    const Type* ResolveType(const String& name) {
+        if (const Type* type = m_Types.Lookup(name)) {
+            return type;
+        }
+        m_Errors.push_back("unknown type " + name + ", emitted as int32_t");
+        return m_Types.GetError();
+    }
+
+    static String GetCType(const Type* type) {
+        switch (type->kind) {
+            case Type::Kind::Integer:
+                return String(type->isSigned ? "int" : "uint") + std::to_string(type->bitWidth).c_str() + "_t";
+            case Type::Kind::Bool:
+                return "bool";
+            case Type::Kind::String:
+                return "const char*";
+            default:
+                return "int32_t";
+        }
+    }
+
+    static const char* GetZeroValue(const Type* type) {
+        switch (type->kind) {
+            case Type::Kind::Bool: return "false";
+            case Type::Kind::String: return "\"\"";
+            default: return "0";
+        }
+    }
+
+    void Indent() {
+        for (int i = 0; i < m_IndentLevel; ++i) {
+            m_Output << "    ";
+        }
+    }
+
+    TypeTable& m_Types;
+    std::ostream& m_Output;
+    Vector<Vector<const Type*>> m_Scopes;
+    const Type* m_LastType = nullptr;
+    int m_IndentLevel = 0;
+    bool m_InFunction = false;
+    Vector<String> m_Errors;
+};
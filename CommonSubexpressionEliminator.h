@@ -0,0 +1,204 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+
+// Turns each function body into a hash-consed expression DAG: structurally
+// identical expression subtrees are replaced by one shared node. Expressions
+// are pure, so sharing never changes meaning. Identifiers are keyed by the
+// scope they resolve to (run after NameResolver), so shadowed names never
+// merge. Top-level statements outside functions form their own region.
+// Expressions reading a variable that is assigned anywhere (a loop counter)
+// are left unshared, since their value depends on where they are evaluated.
+// Bindings are relative to the scope they appear in, so anything reading a
+// variable is only shared between uses at the same nesting depth.
+class CommonSubexpressionEliminator {
+public:
+    void Run(const ASTNodeRef& root) {
+        CollectAssignedBindings(root);
+
+        m_NextScopeId = 0;
+        m_Regions.emplace_back();
+        ASTWalker::Walk(root,
+            [this](ASTNode& node) { Enter(node); return true; },
+            [this](ASTNode& node) { Leave(node); });
+        m_Regions.clear();
+        m_ScopeIds.clear();
+        m_AssignedBindings.clear();
+        m_Unshareable.clear();
+    }
+
+    int GetEliminatedCount() const {
+        return m_EliminatedCount;
+    }
+
+private:
+    struct ExpressionKey {
+        ASTNodeKind kind{};
+        int value = 0;
+        int scopeId = 0;
+        int depth = 0;
+        const ASTNode* left = nullptr;
+        const ASTNode* right = nullptr;
+        String name;
+
+        bool operator==(const ExpressionKey& other) const {
+            return kind == other.kind && value == other.value && scopeId == other.scopeId &&
+                   depth == other.depth &&
+                   left == other.left && right == other.right && name == other.name;
+        }
+    };
+
+    struct ExpressionKeyHash {
+        size_t operator()(const ExpressionKey& key) const {
+            size_t hash = (size_t)key.kind;
+            hash = hash * 31 + std::hash<int>()(key.value);
+            hash = hash * 31 + std::hash<int>()(key.scopeId);
+            hash = hash * 31 + std::hash<int>()(key.depth);
+            hash = hash * 31 + std::hash<const ASTNode*>()(key.left);
+            hash = hash * 31 + std::hash<const ASTNode*>()(key.right);
+            hash = hash * 31 + std::hash<std::string_view>()(key.name);
+            return hash;
+        }
+    };
+
+    using Region = std::unordered_map<ExpressionKey, ASTNodeRef, ExpressionKeyHash>;
+
+    static bool IsExpression(ASTNodeKind kind) {
+        return kind == ASTNodeKind::IntegerLiteralExpression ||
+               kind == ASTNodeKind::IdentifierExpression ||
+               kind == ASTNodeKind::BinaryExpression;
+    }
+
+    static bool OpensScope(ASTNodeKind kind) {
+        return kind == ASTNodeKind::TopStatements || kind == ASTNodeKind::ForStatement ||
+               kind == ASTNodeKind::FunctionDeclaration;
+    }
+
+    // Scope ids are handed out in walk order, so this pre-pass numbers
+    // scopes exactly like the main walk does
+    void CollectAssignedBindings(const ASTNodeRef& root) {
+        m_NextScopeId = 0;
+        ASTWalker::Walk(root,
+            [this](ASTNode& node) {
+                if (OpensScope(node.GetKind())) {
+                    m_ScopeIds.push_back(m_NextScopeId++);
+                } else if (node.GetKind() == ASTNodeKind::AssignmentExpression) {
+                    auto& target = static_cast<AssignmentExpression&>(node).GetTarget();
+                    m_AssignedBindings.insert(MakeKey(*target));
+                }
+                return true;
+            },
+            [this](ASTNode& node) {
+                if (OpensScope(node.GetKind())) {
+                    m_ScopeIds.pop_back();
+                }
+            });
+    }
+
+    void Enter(ASTNode& node) {
+        if (OpensScope(node.GetKind())) {
+            if (node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+                m_Regions.emplace_back();
+            }
+            m_ScopeIds.push_back(m_NextScopeId++);
+        }
+    }
+
+    void Leave(ASTNode& node) {
+        // Children are canonical by now, so keys can compare them by address
+        ASTWalker::ForEachChild(node, [this](ASTNodeRef& child) {
+            if (IsExpression(child->GetKind())) {
+                Canonicalize(child);
+            }
+        });
+
+        switch (node.GetKind()) {
+            case ASTNodeKind::FunctionDeclaration:
+                m_Regions.pop_back();
+                m_ScopeIds.pop_back();
+                break;
+
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+                m_ScopeIds.pop_back();
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void Canonicalize(ASTNodeRef& expr) {
+        ExpressionKey key = MakeKey(*expr);
+        if (IsUnshareable(*expr, key)) {
+            m_Unshareable.insert(expr.get());
+            return;
+        }
+        if (expr->GetKind() != ASTNodeKind::IntegerLiteralExpression) {
+            key.depth = (int)m_ScopeIds.size();
+        }
+
+        Region& region = m_Regions.back();
+        auto [it, inserted] = region.try_emplace(std::move(key), expr);
+        if (!inserted && it->second != expr) {
+            expr = it->second;
+            ++m_EliminatedCount;
+        }
+    }
+
+    bool IsUnshareable(const ASTNode& expr, const ExpressionKey& key) const {
+        if (expr.GetKind() == ASTNodeKind::IdentifierExpression) {
+            return m_AssignedBindings.count(key) > 0;
+        }
+        return m_Unshareable.count(key.left) > 0 || m_Unshareable.count(key.right) > 0;
+    }
+
+    ExpressionKey MakeKey(ASTNode& expr) const {
+        ExpressionKey key;
+        key.kind = expr.GetKind();
+        switch (expr.GetKind()) {
+            // Equal values typed differently by context stay apart
+            case ASTNodeKind::IntegerLiteralExpression: {
+                auto& literal = static_cast<IntegerLiteralExpression&>(expr);
+                key.value = literal.GetValue();
+                key.name = literal.GetType().name;
+                break;
+            }
+
+            case ASTNodeKind::IdentifierExpression: {
+                auto& ident = static_cast<IdentifierExpression&>(expr);
+                const NameBinding& binding = ident.GetBinding();
+                const int scopeIndex = (int)m_ScopeIds.size() - 1 - binding.depth;
+                key.name = ident.GetName();
+                if (binding.kind != NameBinding::Kind::Unresolved && scopeIndex >= 0) {
+                    key.value = binding.slot;
+                    key.scopeId = m_ScopeIds[scopeIndex];
+                } else {
+                    key.scopeId = -1;
+                }
+                break;
+            }
+
+            case ASTNodeKind::BinaryExpression: {
+                auto& binary = static_cast<BinaryExpression&>(expr);
+                key.value = (int)binary.GetOperator();
+                key.left = binary.GetLeft().get();
+                key.right = binary.GetRight().get();
+                break;
+            }
+
+            default:
+                break;
+        }
+        return key;
+    }
+
+    Vector<Region> m_Regions;
+    Vector<int> m_ScopeIds;
+    std::unordered_set<ExpressionKey, ExpressionKeyHash> m_AssignedBindings;
+    HashSet<const ASTNode*> m_Unshareable;
+    int m_NextScopeId = 0;
+    int m_EliminatedCount = 0;
+};
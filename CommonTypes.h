@@ -1,27 +1,52 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 
-using String = std::string;
+#include "MemStats.h"
 
+#if ZIX_ENABLE_MEM_STATS
 template <typename T>
-using Vector = std::vector<T>;
+using Allocator = TrackingAllocator<T>;
+#else
+template <typename T>
+using Allocator = std::allocator<T>;
+#endif
+
+using String = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+
+template <typename T>
+struct Hash : std::hash<T> {};
+
+template <>
+struct Hash<String> {
+    size_t operator()(const String& str) const {
+        return std::hash<std::string_view>()(str);
+    }
+};
+
+template <typename T>
+using Vector = std::vector<T, Allocator<T>>;
 
 template <typename Key, typename T>
-using HashMap = std::unordered_map<Key, T>;
+using HashMap = std::unordered_map<Key, T, Hash<Key>, std::equal_to<Key>, Allocator<std::pair<const Key, T>>>;
 
 template <typename T>
-using HashSet = std::unordered_set<T>;
+using HashSet = std::unordered_set<T, Hash<T>, std::equal_to<T>, Allocator<T>>;
 
 template <typename T>
 using SharedPtr = std::shared_ptr<T>;
 
 template <typename T, class... Args>
 inline SharedPtr<T> MakeShared(Args&&... args) {
+#if ZIX_ENABLE_MEM_STATS
+    MemStats::NodeKindScope kind(MemStats::NodeKindName<T> ? MemStats::NodeKindName<T> : MemStats::CurrentNodeKind());
+    return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+#else
     return std::make_shared<T, Args...>(std::forward<Args>(args)...);
+#endif
 };
-
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "ASTWalker.h"
+#include "CommonTypes.h"
+#include "Diagnostics.h"
+#include "FunctionDeclCollector.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "QueryEngine.h"
+
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <utility>
+
+using FileFunctionKey = std::pair<String, String>;
+
+template <>
+struct Hash<FileFunctionKey> {
+    size_t operator()(const FileFunctionKey& key) const {
+        const size_t file = Hash<String>()(key.first);
+        return file ^ (Hash<String>()(key.second) + 0x9e3779b97f4a7c15ull + (file << 6) + (file >> 2));
+    }
+};
+
+// Copied out of the AST so it can be compared across revisions
+struct FunctionSignature {
+    String name;
+    Vector<FuncParam> parameters;
+    String returnType;
+
+    bool operator==(const FunctionSignature& other) const {
+        if (name != other.name || returnType != other.returnType || parameters.size() != other.parameters.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            if (parameters[i].name != other.parameters[i].name || parameters[i].type != other.parameters[i].type) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const FunctionSignature& other) const {
+        return !(*this == other);
+    }
+};
+
+struct FunctionHash {
+    String name;
+    StructuralHash hash;
+};
+
+struct TokenizedFile {
+    TokenList tokens;
+    DiagnosticEngine diagnostics;
+    bool ok = false;
+};
+
+struct ParsedFile {
+    ASTNodeRef root;
+    DiagnosticEngine diagnostics;
+};
+
+// The front end as queries over file texts. Tokens and ASTs are re-executed
+// whenever their file's text is set again; signatures are backdated, so
+// anything that only reads signatures survives edits inside function bodies.
+// Function hashes are backdated the same way, so a function whose subtree
+// didn't change keeps its old changedAt and can be skipped downstream.
+class CompilerDatabase {
+public:
+    CompilerDatabase()
+        : m_SourceText(m_Engine, "SourceText"),
+          m_Tokens(m_Engine, "Tokens", [this](const String& file) { return ComputeTokens(file); }),
+          m_AST(m_Engine, "AST", [this](const String& file) { return ComputeAST(file); }),
+          m_Signatures(m_Engine, "FunctionSignatures", [this](const String& file) { return ComputeSignatures(file); }),
+          m_Signature(m_Engine, "Signature", [this](const FileFunctionKey& key) { return ComputeSignature(key); }),
+          m_FunctionHashes(m_Engine, "FunctionHashes", [this](const String& file) { return ComputeFunctionHashes(file); }),
+          m_FunctionHash(m_Engine, "FunctionHash", [this](const FileFunctionKey& key) { return ComputeFunctionHash(key); })
+    {}
+
+    void SetSourceText(const String& file, String text) {
+        m_SourceText.Set(file, std::move(text));
+    }
+
+    SharedPtr<const TokenizedFile> GetTokens(const String& file) {
+        return m_Tokens.Get(file);
+    }
+
+    SharedPtr<const ParsedFile> GetAST(const String& file) {
+        return m_AST.Get(file);
+    }
+
+    // Sorted by name
+    SharedPtr<const Vector<FunctionSignature>> GetFunctionSignatures(const String& file) {
+        return m_Signatures.Get(file);
+    }
+
+    SharedPtr<const std::optional<FunctionSignature>> GetSignature(const String& file, const String& name) {
+        return m_Signature.Get(FileFunctionKey{ file, name });
+    }
+
+    SharedPtr<const std::optional<StructuralHash>> GetFunctionHash(const String& file, const String& name) {
+        return m_FunctionHash.Get(FileFunctionKey{ file, name });
+    }
+
+    // Revision at which the function's subtree last changed
+    Revision GetFunctionChangedAt(const String& file, const String& name) {
+        return m_FunctionHash.GetChangedAt(FileFunctionKey{ file, name });
+    }
+
+    Revision GetRevision() const {
+        return m_Engine.GetRevision();
+    }
+
+    void DumpStats(std::ostream& out = std::cerr) const {
+        out << "Revision " << m_Engine.GetRevision() << '\n';
+        const QueryTableBase* tables[] = { &m_SourceText, &m_Tokens, &m_AST, &m_Signatures, &m_Signature,
+                                             &m_FunctionHashes, &m_FunctionHash };
+        for (const QueryTableBase* table : tables) {
+            out << "  " << table->GetName() << ": " << table->GetExecutionCount() << " executions\n";
+        }
+    }
+
+private:
+    TokenizedFile ComputeTokens(const String& file) {
+        TokenizedFile result;
+        SharedPtr<const String> text = m_SourceText.Get(file);
+        if (!text) {
+            return result;
+        }
+
+        Lexer lexer(file.c_str(), *text);
+        auto tokenized = Tokenize(lexer, result.diagnostics);
+        result.ok = tokenized.isOk();
+        if (result.ok) {
+            result.tokens = std::move(tokenized).unwrap();
+        }
+        return result;
+    }
+
+    ParsedFile ComputeAST(const String& file) {
+        ParsedFile result;
+        SharedPtr<const TokenizedFile> tokens = m_Tokens.Get(file);
+        result.diagnostics = tokens->diagnostics;
+        if (tokens->ok) {
+            result.root = Parse(tokens->tokens, result.diagnostics);
+        }
+        return result;
+    }
+
+    Vector<FunctionSignature> ComputeSignatures(const String& file) {
+        Vector<FunctionSignature> signatures;
+        SharedPtr<const ParsedFile> parsed = m_AST.Get(file);
+        if (!parsed->root) {
+            return signatures;
+        }
+
+        FunctionSymbolTable table;
+        FunctionDeclCollector collector(table, file.c_str());
+        parsed->root->Accept(collector);
+        table.ForEach([&](const String& name, const FunctionDeclMetaData& meta) {
+            signatures.push_back(FunctionSignature{ name, meta.GetParameters(), meta.GetReturnType() });
+        });
+        std::sort(signatures.begin(), signatures.end(), [](const FunctionSignature& a, const FunctionSignature& b) {
+            return a.name < b.name;
+        });
+        return signatures;
+    }
+
+    std::optional<FunctionSignature> ComputeSignature(const FileFunctionKey& key) {
+        SharedPtr<const Vector<FunctionSignature>> signatures = m_Signatures.Get(key.first);
+        auto it = std::lower_bound(signatures->begin(), signatures->end(), key.second,
+                                   [](const FunctionSignature& signature, const String& name) {
+                                       return signature.name < name;
+                                   });
+        if (it == signatures->end() || it->name != key.second) {
+            return std::nullopt;
+        }
+        return *it;
+    }
+
+    // Sorted by name; the first declaration wins for duplicated names
+    Vector<FunctionHash> ComputeFunctionHashes(const String& file) {
+        Vector<FunctionHash> hashes;
+        SharedPtr<const ParsedFile> parsed = m_AST.Get(file);
+        ASTWalker::ForEachNode(parsed->root, [&](ASTNode& node) {
+            if (node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+                hashes.push_back(FunctionHash{ static_cast<FunctionDeclaration&>(node).GetName(),
+                                               node.GetStructuralHash() });
+            }
+        });
+        std::stable_sort(hashes.begin(), hashes.end(), [](const FunctionHash& a, const FunctionHash& b) {
+            return a.name < b.name;
+        });
+        return hashes;
+    }
+
+    std::optional<StructuralHash> ComputeFunctionHash(const FileFunctionKey& key) {
+        SharedPtr<const Vector<FunctionHash>> hashes = m_FunctionHashes.Get(key.first);
+        auto it = std::lower_bound(hashes->begin(), hashes->end(), key.second,
+                                   [](const FunctionHash& entry, const String& name) {
+                                       return entry.name < name;
+                                   });
+        if (it == hashes->end() || it->name != key.second) {
+            return std::nullopt;
+        }
+        return it->hash;
+    }
+
+    QueryEngine m_Engine;
+    InputTable<String, String> m_SourceText;
+    QueryTable<String, TokenizedFile> m_Tokens;
+    QueryTable<String, ParsedFile> m_AST;
+    QueryTable<String, Vector<FunctionSignature>, true> m_Signatures;
+    QueryTable<FileFunctionKey, std::optional<FunctionSignature>, true> m_Signature;
+    QueryTable<String, Vector<FunctionHash>> m_FunctionHashes;
+    QueryTable<FileFunctionKey, std::optional<StructuralHash>, true> m_FunctionHash;
+};
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+#include "NameResolver.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Removes top-level functions that are unreachable from the entry points and
+// let bindings that are never read (when their initializer is pure). Removing
+// a binding releases the uses in its initializer, so chains of dead bindings
+// go away in one worklist pass. Works on a name-resolved AST and re-runs
+// NameResolver afterwards, since removal renumbers scope slots.
+//
+// A program that declares none of the entry points (a library, say) would
+// lose every function, so in that case functions are all kept and a warning
+// is recorded instead.
+class DeadCodeEliminator {
+public:
+    explicit DeadCodeEliminator(Vector<String> entryPoints = { "main" })
+        : m_EntryPoints(std::move(entryPoints))
+    {}
+
+    void Run(const ASTNodeRef& root) {
+        if (!root || root->GetKind() != ASTNodeKind::TopStatements) {
+            return;
+        }
+
+        auto& top = static_cast<TopStatements&>(*root);
+        m_KeepFunctions = !DeclaresEntryPoint(top);
+        if (m_KeepFunctions && DeclaresFunction(top)) {
+            String names;
+            for (const auto& name : m_EntryPoints) {
+                names += names.empty() ? "" : ", ";
+                names += name;
+            }
+            m_Warnings.push_back("no entry function (" + names + ") is declared; keeping every function");
+        }
+
+        // Dropping a binding can orphan the functions it referenced and
+        // dropping a function can orphan the globals it read, so repeat
+        // until neither step removes anything
+        bool changed = true;
+        while (changed) {
+            const int removedBefore = m_RemovedFunctions + m_RemovedBindings;
+            if (!m_KeepFunctions) {
+                PruneUnusedFunctions(top);
+            }
+            RemoveDeadBindings(root);
+            NameResolver{}.Resolve(root);
+            changed = m_RemovedFunctions + m_RemovedBindings != removedBefore;
+        }
+    }
+
+    int GetRemovedFunctionCount() const {
+        return m_RemovedFunctions;
+    }
+
+    int GetRemovedBindingCount() const {
+        return m_RemovedBindings;
+    }
+
+    const Vector<String>& GetWarnings() const {
+        return m_Warnings;
+    }
+
+    void DumpWarnings(std::ostream& out = std::cerr) const {
+        for (const auto& warning : m_Warnings) {
+            out << "Warning: " << warning << std::endl;
+        }
+    }
+
+private:
+    bool DeclaresEntryPoint(const TopStatements& top) const {
+        for (const auto& stat : top.GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::FunctionDeclaration &&
+                std::find(m_EntryPoints.begin(), m_EntryPoints.end(),
+                          static_cast<const FunctionDeclaration&>(*stat).GetName()) != m_EntryPoints.end()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool DeclaresFunction(const TopStatements& top) {
+        return std::any_of(top.GetStatements().begin(), top.GetStatements().end(), [](const ASTNodeRef& stat) {
+            return stat->GetKind() == ASTNodeKind::FunctionDeclaration;
+        });
+    }
+
+    static bool IsPureExpression(const ASTNodeRef& expr) {
+        bool pure = true;
+        ASTWalker::ForEachNode(expr, [&](ASTNode& node) {
+            switch (node.GetKind()) {
+                case ASTNodeKind::IntegerLiteralExpression:
+                case ASTNodeKind::IdentifierExpression:
+                case ASTNodeKind::BinaryExpression:
+                    break;
+                default:
+                    pure = false;
+            }
+        });
+        return pure;
+    }
+
+    // Functions are referenced by name through identifiers that don't
+    // resolve to a local or parameter
+    template <typename Func>
+    static void ForEachFunctionReference(const ASTNodeRef& root, Func&& func) {
+        ASTWalker::ForEachNode(root, [&](ASTNode& node) {
+            if (node.GetKind() == ASTNodeKind::IdentifierExpression) {
+                auto& ident = static_cast<IdentifierExpression&>(node);
+                if (ident.GetBinding().kind == NameBinding::Kind::Unresolved) {
+                    func(ident.GetName());
+                }
+            }
+        });
+    }
+
+    void PruneUnusedFunctions(TopStatements& top) {
+        auto& statements = top.GetStatements();
+
+        HashMap<String, ASTNodeRef> functions;
+        for (const auto& stat : statements) {
+            if (stat->GetKind() == ASTNodeKind::FunctionDeclaration) {
+                functions.emplace(static_cast<FunctionDeclaration&>(*stat).GetName(), stat);
+            }
+        }
+
+        HashSet<String> live;
+        Vector<ASTNodeRef> worklist;
+        auto MarkLive = [&](const String& name) {
+            auto it = functions.find(name);
+            if (it != functions.end() && live.insert(name).second) {
+                worklist.push_back(it->second);
+            }
+        };
+
+        for (const auto& name : m_EntryPoints) {
+            MarkLive(name);
+        }
+        for (const auto& stat : statements) {
+            if (stat->GetKind() != ASTNodeKind::FunctionDeclaration) {
+                ForEachFunctionReference(stat, MarkLive);
+            }
+        }
+        while (!worklist.empty()) {
+            ASTNodeRef function = std::move(worklist.back());
+            worklist.pop_back();
+            ForEachFunctionReference(static_cast<FunctionDeclaration&>(*function).GetBody(), MarkLive);
+        }
+
+        auto dead = std::remove_if(statements.begin(), statements.end(), [&](const ASTNodeRef& stat) {
+            return stat->GetKind() == ASTNodeKind::FunctionDeclaration &&
+                   !live.count(static_cast<FunctionDeclaration&>(*stat).GetName());
+        });
+        m_RemovedFunctions += (int)(statements.end() - dead);
+        statements.erase(dead, statements.end());
+    }
+
+    struct Binding {
+        VariableDeclaration* declaration = nullptr;
+        TopStatements* block = nullptr;
+        int uses = 0;
+        bool removable = false;
+        Vector<int> initializerUses;
+    };
+
+    // Binding ids per scope slot, mirroring NameResolver's scopes;
+    // -1 marks a parameter
+    struct Scope {
+        Vector<int> slots;
+        ASTNode* block = nullptr;
+    };
+
+    void RemoveDeadBindings(const ASTNodeRef& root) {
+        m_Bindings.clear();
+        m_Scopes.clear();
+        m_CurrentDeclaration = -1;
+
+        ASTWalker::Walk(root,
+            [this](ASTNode& node) { EnterForLiveness(node); return true; },
+            [this](ASTNode& node) { LeaveForLiveness(node); });
+
+        Vector<int> worklist;
+        for (int id = 0; id < (int)m_Bindings.size(); ++id) {
+            if (m_Bindings[id].uses == 0 && m_Bindings[id].removable) {
+                worklist.push_back(id);
+            }
+        }
+
+        HashSet<const ASTNode*> removed;
+        HashSet<TopStatements*> touchedBlocks;
+        while (!worklist.empty()) {
+            Binding& binding = m_Bindings[worklist.back()];
+            worklist.pop_back();
+
+            removed.insert(binding.declaration);
+            touchedBlocks.insert(binding.block);
+            for (int used : binding.initializerUses) {
+                Binding& usedBinding = m_Bindings[used];
+                if (--usedBinding.uses == 0 && usedBinding.removable) {
+                    worklist.push_back(used);
+                }
+            }
+        }
+
+        for (TopStatements* block : touchedBlocks) {
+            auto& statements = block->GetStatements();
+            auto dead = std::remove_if(statements.begin(), statements.end(), [&](const ASTNodeRef& stat) {
+                return removed.count(stat.get()) > 0;
+            });
+            statements.erase(dead, statements.end());
+        }
+        m_RemovedBindings += (int)removed.size();
+    }
+
+    void EnterForLiveness(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+                m_Scopes.push_back(Scope{ {}, &node });
+                break;
+
+            case ASTNodeKind::FunctionDeclaration: {
+                auto& decl = static_cast<FunctionDeclaration&>(node);
+                m_Scopes.push_back(Scope{ Vector<int>(decl.GetParameters().size(), -1), nullptr });
+                break;
+            }
+
+            case ASTNodeKind::VariableDeclaration: {
+                auto& decl = static_cast<VariableDeclaration&>(node);
+                ASTNode* block = m_Scopes.empty() ? nullptr : m_Scopes.back().block;
+
+                Binding binding;
+                binding.declaration = &decl;
+                if (block && block->GetKind() == ASTNodeKind::TopStatements) {
+                    binding.block = static_cast<TopStatements*>(block);
+                    binding.removable = IsPureExpression(decl.GetInitialValue());
+                }
+                m_CurrentDeclaration = (int)m_Bindings.size();
+                m_Bindings.push_back(std::move(binding));
+                break;
+            }
+
+            case ASTNodeKind::IdentifierExpression:
+                RecordUse(static_cast<IdentifierExpression&>(node).GetBinding());
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void LeaveForLiveness(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+            case ASTNodeKind::FunctionDeclaration:
+                m_Scopes.pop_back();
+                break;
+
+            // Declared on leave, matching NameResolver's slot numbering
+            case ASTNodeKind::VariableDeclaration:
+                if (!m_Scopes.empty()) {
+                    m_Scopes.back().slots.push_back(m_CurrentDeclaration);
+                }
+                m_CurrentDeclaration = -1;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void RecordUse(const NameBinding& binding) {
+        const int scopeIndex = (int)m_Scopes.size() - 1 - binding.depth;
+        if (binding.kind != NameBinding::Kind::Local || scopeIndex < 0) {
+            return;
+        }
+
+        const auto& slots = m_Scopes[scopeIndex].slots;
+        if (binding.slot >= (int)slots.size() || slots[binding.slot] < 0) {
+            return;
+        }
+
+        const int used = slots[binding.slot];
+        ++m_Bindings[used].uses;
+        if (m_CurrentDeclaration >= 0) {
+            m_Bindings[m_CurrentDeclaration].initializerUses.push_back(used);
+        }
+    }
+
+    Vector<String> m_EntryPoints;
+    Vector<String> m_Warnings;
+    bool m_KeepFunctions = false;
+    Vector<Binding> m_Bindings;
+    Vector<Scope> m_Scopes;
+    int m_CurrentDeclaration = -1;
+    int m_RemovedFunctions = 0;
+    int m_RemovedBindings = 0;
+};
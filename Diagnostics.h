@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Token.h"
+
+#include <iostream>
+
+struct SourceRange {
+    Location begin;
+    Location end;
+};
+
+enum class DiagnosticSeverity {
+    Error,
+    Warning,
+};
+
+struct Diagnostic {
+    DiagnosticSeverity severity;
+    SourceRange range;
+    String message;
+};
+
+// Collects every problem found in a run so one pass can report them all.
+// Nothing is allocated until the first diagnostic is reported.
+class DiagnosticEngine {
+public:
+    void Error(SourceRange range, String message) {
+        m_Diagnostics.push_back(Diagnostic{ DiagnosticSeverity::Error, range, std::move(message) });
+        ++m_ErrorCount;
+    }
+
+    void Warning(SourceRange range, String message) {
+        m_Diagnostics.push_back(Diagnostic{ DiagnosticSeverity::Warning, range, std::move(message) });
+    }
+
+    bool HasErrors() const {
+        return m_ErrorCount > 0;
+    }
+
+    int GetErrorCount() const {
+        return m_ErrorCount;
+    }
+
+    const Vector<Diagnostic>& GetDiagnostics() const {
+        return m_Diagnostics;
+    }
+
+    void Dump(std::ostream& out = std::cerr, const char* filename = nullptr) const {
+        for (const auto& diag : m_Diagnostics) {
+            if (filename) out << filename << ':';
+            out << diag.range.begin.line << ':' << diag.range.begin.column << ": ";
+            out << (diag.severity == DiagnosticSeverity::Error ? "error: " : "warning: ");
+            out << diag.message << std::endl;
+        }
+    }
+
+private:
+    Vector<Diagnostic> m_Diagnostics;
+    int m_ErrorCount = 0;
+};
@@ -1,11 +1,24 @@
 #pragma once
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+#include "Trace.h"
 
 namespace FileUtils
 {
     static char* ReadFile(const char* filename) {
+        TRACE_SCOPE_FILE("ReadFile", filename);
         FILE* file = fopen(filename, "r");
+        if (!file) {
+            return nullptr;
+        }
+
         fseek(file, 0, SEEK_END);
         size_t filesize = ftell(file);
         rewind(file);
@@ -13,7 +26,74 @@ namespace FileUtils
         char* buffer = new char[filesize + 1];
         size_t bytesRead = fread(buffer, sizeof(char), filesize, file);
         buffer[bytesRead] = '\0';
+        fclose(file);
         return buffer;
     }
-}
 
+    // Read-only private mapping of a whole file, unmapped on destruction
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        MappedFile(MappedFile&& other) noexcept
+            : m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0))
+        {}
+
+        MappedFile& operator=(MappedFile&& other) noexcept {
+            if (this != &other) {
+                Unmap();
+                m_Data = std::exchange(other.m_Data, nullptr);
+                m_Size = std::exchange(other.m_Size, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile() {
+            Unmap();
+        }
+
+        bool Map(const char* filename) {
+            TRACE_SCOPE_FILE("MapFile", filename);
+            Unmap();
+            const int fd = open(filename, O_RDONLY);
+            if (fd < 0) {
+                return false;
+            }
+
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+                close(fd);
+                return false;
+            }
+
+            void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED) {
+                return false;
+            }
+            m_Data = data;
+            m_Size = (size_t)info.st_size;
+            return true;
+        }
+
+        const void* GetData() const {
+            return m_Data;
+        }
+
+        size_t GetSize() const {
+            return m_Size;
+        }
+
+    private:
+        void Unmap() {
+            if (m_Data) {
+                munmap(m_Data, m_Size);
+                m_Data = nullptr;
+                m_Size = 0;
+            }
+        }
+
+        void* m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+}
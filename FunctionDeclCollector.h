@@ -3,13 +3,45 @@
 #include "CommonTypes.h"
 #include "ASTVisitor.h"
 #include "ASTNode.h"
+#include "ShardedSymbolTable.h"
 
+// Refers into the AST instead of copying the signature,
+// so it is only valid while the declaring tree is alive
 struct FunctionDeclMetaData {
-    Vector<FuncParam> parameters;
-    String returnType;
+    const FunctionDeclaration* declaration = nullptr;
+    const char* file = nullptr;
+
+    const Vector<FuncParam>& GetParameters() const {
+        return declaration->GetParameters();
+    }
+
+    const String& GetReturnType() const {
+        return declaration->GetReturnType();
+    }
+
+    const Location& GetLocation() const {
+        return declaration->GetLocation();
+    }
 };
 
+using FunctionSymbolTable = ShardedSymbolTable<FunctionDeclMetaData>;
+
+struct DuplicateFunctionDecl {
+    FunctionDeclMetaData previous;
+    FunctionDeclMetaData duplicate;
+};
+
+// Collectors for different files (possibly on different threads)
+// can share one FunctionSymbolTable
 struct FunctionDeclCollector final : public ASTVisitor {
+    FunctionDeclCollector()
+        : m_OwnedTable(MakeShared<FunctionSymbolTable>()), m_FunctionDecls(*m_OwnedTable)
+    {}
+
+    explicit FunctionDeclCollector(FunctionSymbolTable& table, const char* file = nullptr)
+        : m_FunctionDecls(table), m_File(file)
+    {}
+
     virtual void Visit(const TopStatements& node) override {
         for (const auto& stat : node.GetStatements()) {
             stat->Accept(*this);
@@ -17,26 +49,43 @@ struct FunctionDeclCollector final : public ASTVisitor {
     }
 
     virtual void Visit(const FunctionDeclaration& decl) override {
-        FunctionDeclMetaData meta;
-        meta.parameters = decl.GetParameters();
-        meta.returnType = decl.GetReturnType();
-        m_FunctionDecls.emplace(decl.GetName(), meta);
+        FunctionDeclMetaData meta{ &decl, m_File };
+        FunctionDeclMetaData previous;
+        if (!m_FunctionDecls.Insert(decl.GetName(), meta, &previous)) {
+            m_Duplicates.push_back(DuplicateFunctionDecl{ previous, meta });
+        }
         decl.GetBody()->Accept(*this);
     }
 
+    const Vector<DuplicateFunctionDecl>& GetDuplicates() const {
+        return m_Duplicates;
+    }
+
+    void DumpDuplicates(std::ostream& out = std::cerr) const {
+        for (const auto& dup : m_Duplicates) {
+            out << "Duplicate definition of fn " << dup.duplicate.declaration->GetName();
+            if (dup.duplicate.file) out << " in " << dup.duplicate.file;
+            if (dup.previous.file) out << " (previously defined in " << dup.previous.file << ")";
+            out << std::endl;
+        }
+    }
+
     void DumpDeclarations(std::ostream& out = std::cout) {
-        for (const auto& [name, meta] : m_FunctionDecls) {
+        m_FunctionDecls.ForEach([&](const String& name, const FunctionDeclMetaData& meta) {
+            const auto& parameters = meta.GetParameters();
             out << "fn " << name << "(";
-            if (!meta.parameters.empty()) {
-                out << meta.parameters[0].name << ": " << meta.parameters[0].type;
-                for (size_t i = 1; i < meta.parameters.size(); ++i) {
-                    out << ", " << meta.parameters[i].name << ": " << meta.parameters[i].type;
+            if (!parameters.empty()) {
+                out << parameters[0].name << ": " << parameters[0].type;
+                for (size_t i = 1; i < parameters.size(); ++i) {
+                    out << ", " << parameters[i].name << ": " << parameters[i].type;
                 }
             }
-            out << ") -> " << meta.returnType << std::endl;
-        }
+            out << ") -> " << meta.GetReturnType() << std::endl;
+        });
     }
 
-    HashMap<String, FunctionDeclMetaData> m_FunctionDecls;
+    SharedPtr<FunctionSymbolTable> m_OwnedTable;
+    FunctionSymbolTable& m_FunctionDecls;
+    const char* m_File = nullptr;
+    Vector<DuplicateFunctionDecl> m_Duplicates;
 };
-
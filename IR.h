@@ -0,0 +1,265 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "TypeTable.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#define IR_OPCODE_LIST(MACRO) \
+    MACRO(Param, "param")     \
+    MACRO(Const, "const")     \
+    MACRO(Global, "global")   \
+    MACRO(Add, "add")         \
+    MACRO(Sub, "sub")         \
+    MACRO(Mul, "mul")         \
+    MACRO(Div, "div")         \
+    MACRO(Lt, "lt")           \
+    MACRO(Gt, "gt")           \
+    MACRO(Phi, "phi")         \
+    MACRO(Jump, "jump")       \
+    MACRO(Branch, "br")       \
+    MACRO(Return, "ret")
+
+#define GENERATE_IR_OPCODE_ENUM(NAME, MNEMONIC) NAME,
+
+enum class IROpcode : uint8_t {
+    IR_OPCODE_LIST(GENERATE_IR_OPCODE_ENUM)
+};
+
+#undef GENERATE_IR_OPCODE_ENUM
+
+#define GENERATE_IR_OPCODE_MNEMONIC(NAME, MNEMONIC) case IROpcode::NAME: return MNEMONIC;
+
+static const char* GetOpcodeMnemonic(IROpcode opcode) {
+    switch (opcode) {
+        IR_OPCODE_LIST(GENERATE_IR_OPCODE_MNEMONIC)
+    }
+    return "?";
+}
+
+#undef GENERATE_IR_OPCODE_MNEMONIC
+
+// Values and blocks are indices into their function's arrays
+using IRValue = uint32_t;
+using IRBlockId = uint32_t;
+
+constexpr IRValue NoIRValue = UINT32_MAX;
+
+// Operands live in the function's shared operand array:
+//   phi:    value0, block0, value1, block1, ...
+//   jump:   target
+//   br:     condition, trueTarget, falseTarget
+//   ret:    optional value
+//   others: value operands
+struct IRInstruction {
+    IROpcode opcode;
+    bool dead = false;
+    IRBlockId block = 0;
+    const Type* type = nullptr;     // nullptr for terminators
+    uint32_t firstOperand = 0;
+    uint32_t operandCount = 0;
+    int32_t immediate = 0;          // const value, param index or global name index
+
+    bool IsTerminator() const {
+        return opcode == IROpcode::Jump || opcode == IROpcode::Branch || opcode == IROpcode::Return;
+    }
+
+    bool IsValueOperand(uint32_t index) const {
+        switch (opcode) {
+            case IROpcode::Phi: return index % 2 == 0;
+            case IROpcode::Jump: return false;
+            case IROpcode::Branch: return index == 0;
+            default: return true;
+        }
+    }
+};
+
+struct IRBlock {
+    Vector<IRValue> instructions;
+    Vector<IRBlockId> predecessors;
+};
+
+// One function in SSA form. Instructions and operands are stored in two flat
+// arrays owned by the function, so building and walking the IR touches a few
+// contiguous allocations instead of a node per instruction.
+class IRFunction {
+public:
+    IRFunction(String name, const Type* type)
+        : m_Name(std::move(name)), m_Type(type)
+    {}
+
+    const String& GetName() const { return m_Name; }
+    const Type* GetType() const { return m_Type; }
+
+    IRBlockId AddBlock() {
+        m_Blocks.emplace_back();
+        return (IRBlockId)m_Blocks.size() - 1;
+    }
+
+    IRValue Append(IRBlockId block, IROpcode opcode, const Type* type,
+                   std::initializer_list<uint32_t> operands = {}, int32_t immediate = 0) {
+        IRValue value = Create(block, opcode, type, immediate);
+        SetOperands(value, operands.begin(), operands.size());
+        m_Blocks[block].instructions.push_back(value);
+        return value;
+    }
+
+    // Phis go in front of every other instruction of their block; their
+    // operands are filled in later with SetOperands
+    IRValue InsertPhi(IRBlockId block, const Type* type) {
+        IRValue value = Create(block, IROpcode::Phi, type, 0);
+        auto& instructions = m_Blocks[block].instructions;
+        auto it = instructions.begin();
+        while (it != instructions.end() && m_Instructions[*it].opcode == IROpcode::Phi) {
+            ++it;
+        }
+        instructions.insert(it, value);
+        return value;
+    }
+
+    // Appends a fresh operand run; a replaced run is simply abandoned
+    void SetOperands(IRValue value, const uint32_t* operands, size_t count) {
+        IRInstruction& inst = m_Instructions[value];
+        inst.firstOperand = (uint32_t)m_Operands.size();
+        inst.operandCount = (uint32_t)count;
+        m_Operands.insert(m_Operands.end(), operands, operands + count);
+    }
+
+    void AddEdge(IRBlockId from, IRBlockId to) {
+        m_Blocks[to].predecessors.push_back(from);
+    }
+
+    // Removes the instruction from its block; its index stays valid but dead
+    void Remove(IRValue value) {
+        IRInstruction& inst = m_Instructions[value];
+        auto& instructions = m_Blocks[inst.block].instructions;
+        instructions.erase(std::find(instructions.begin(), instructions.end(), value));
+        inst.dead = true;
+    }
+
+    void ReplaceAllUses(IRValue from, IRValue to) {
+        for (auto& inst : m_Instructions) {
+            if (inst.dead) continue;
+            for (uint32_t i = 0; i < inst.operandCount; ++i) {
+                uint32_t& operand = m_Operands[inst.firstOperand + i];
+                if (inst.IsValueOperand(i) && operand == from) {
+                    operand = to;
+                }
+            }
+        }
+    }
+
+    template <typename Func>
+    void ForEachSuccessor(IRBlockId block, Func&& func) const {
+        const auto& instructions = m_Blocks[block].instructions;
+        if (instructions.empty()) {
+            return;
+        }
+        const IRInstruction& term = m_Instructions[instructions.back()];
+        for (uint32_t i = 0; i < term.operandCount; ++i) {
+            if (term.IsTerminator() && !term.IsValueOperand(i)) {
+                func((IRBlockId)GetOperand(term, i));
+            }
+        }
+    }
+
+    uint32_t GetOperand(const IRInstruction& inst, uint32_t index) const {
+        return m_Operands[inst.firstOperand + index];
+    }
+
+    IRInstruction& operator[](IRValue value) { return m_Instructions[value]; }
+    const IRInstruction& operator[](IRValue value) const { return m_Instructions[value]; }
+
+    Vector<IRBlock>& GetBlocks() { return m_Blocks; }
+    const Vector<IRBlock>& GetBlocks() const { return m_Blocks; }
+    size_t GetInstructionCount() const { return m_Instructions.size(); }
+
+    int32_t InternGlobal(const String& name) {
+        for (size_t i = 0; i < m_Globals.size(); ++i) {
+            if (m_Globals[i] == name) return (int32_t)i;
+        }
+        m_Globals.push_back(name);
+        return (int32_t)m_Globals.size() - 1;
+    }
+
+    void Dump(std::ostream& out = std::cout) const {
+        out << "fn " << m_Name << " : " << (m_Type ? m_Type->name : String("?")) << " {\n";
+        for (IRBlockId block = 0; block < m_Blocks.size(); ++block) {
+            out << "bb" << block << ":";
+            if (!m_Blocks[block].predecessors.empty()) {
+                out << "  ; preds";
+                for (IRBlockId pred : m_Blocks[block].predecessors) {
+                    out << " bb" << pred;
+                }
+            }
+            out << "\n";
+            for (IRValue value : m_Blocks[block].instructions) {
+                DumpInstruction(out, value);
+            }
+        }
+        out << "}\n";
+    }
+
+private:
+    IRValue Create(IRBlockId block, IROpcode opcode, const Type* type, int32_t immediate) {
+        IRInstruction& inst = m_Instructions.emplace_back();
+        inst.opcode = opcode;
+        inst.block = block;
+        inst.type = type;
+        inst.immediate = immediate;
+        return (IRValue)m_Instructions.size() - 1;
+    }
+
+    void DumpInstruction(std::ostream& out, IRValue value) const {
+        const IRInstruction& inst = m_Instructions[value];
+        out << "    ";
+        if (inst.type) {
+            out << '%' << value << " = ";
+        }
+        out << GetOpcodeMnemonic(inst.opcode);
+
+        switch (inst.opcode) {
+            case IROpcode::Param:
+            case IROpcode::Const:
+                out << ' ' << inst.immediate;
+                break;
+            case IROpcode::Global:
+                out << " @" << m_Globals[inst.immediate];
+                break;
+            case IROpcode::Phi:
+                for (uint32_t i = 0; i < inst.operandCount; i += 2) {
+                    out << (i ? ", [%" : " [%") << GetOperand(inst, i) << ", bb" << GetOperand(inst, i + 1) << ']';
+                }
+                break;
+            default:
+                for (uint32_t i = 0; i < inst.operandCount; ++i) {
+                    out << (i ? ", " : " ") << (inst.IsValueOperand(i) ? "%" : "bb") << GetOperand(inst, i);
+                }
+                break;
+        }
+
+        if (inst.type) {
+            out << " : " << inst.type->name;
+        }
+        out << "\n";
+    }
+
+    String m_Name;
+    const Type* m_Type;
+    Vector<IRInstruction> m_Instructions;
+    Vector<uint32_t> m_Operands;
+    Vector<IRBlock> m_Blocks;
+    Vector<String> m_Globals;
+};
+
+struct IRModule {
+    Vector<IRFunction> functions;
+
+    void Dump(std::ostream& out = std::cout) const {
+        for (const auto& function : functions) {
+            function.Dump(out);
+        }
+    }
+};
@@ -0,0 +1,412 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+#include "IR.h"
+#include "TypeTable.h"
+
+#include <iostream>
+
+// Lowers every top-level FunctionDeclaration of a name-resolved AST into SSA
+// form. SSA values are built on the fly following Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form": a variable read
+// looks up its definition in the current block and otherwise recurses into
+// the predecessors, placing phis at joins and in loop headers that are not
+// sealed yet. Trivial phis are removed once the function is complete.
+// Names bound outside the function become `global` reads.
+class IRBuilder {
+public:
+    explicit IRBuilder(TypeTable& types)
+        : m_Types(types)
+    {}
+
+    IRModule Lower(const ASTNodeRef& root) {
+        IRModule module;
+        if (!root || root->GetKind() != ASTNodeKind::TopStatements) {
+            return module;
+        }
+
+        for (const auto& stat : static_cast<TopStatements&>(*root).GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::VariableDeclaration) {
+                auto& decl = static_cast<VariableDeclaration&>(*stat);
+                m_GlobalTypes[decl.GetName()] = InferGlobalType(decl.GetInitialValue());
+            } else if (stat->GetKind() == ASTNodeKind::FunctionDeclaration) {
+                module.functions.push_back(LowerFunction(static_cast<FunctionDeclaration&>(*stat)));
+            }
+        }
+        return module;
+    }
+
+    const Vector<String>& GetErrors() const {
+        return m_Errors;
+    }
+
+    void DumpErrors(std::ostream& out = std::cerr) const {
+        for (const auto& error : m_Errors) {
+            out << "IR error: " << error << std::endl;
+        }
+    }
+
+private:
+    struct Variable {
+        const Type* type;
+    };
+
+    struct IncompletePhi {
+        int variable;
+        IRValue phi;
+    };
+
+    IRFunction LowerFunction(FunctionDeclaration& decl) {
+        Vector<const Type*> paramTypes;
+        for (const auto& param : decl.GetParameters()) {
+            paramTypes.push_back(ResolveType(param.type));
+        }
+        const Type* returnType = ResolveType(decl.GetReturnType());
+
+        IRFunction function(decl.GetName(), m_Types.GetFunction(paramTypes, returnType));
+        m_Function = &function;
+        m_Variables.clear();
+        m_CurrentDefs.clear();
+        m_Sealed.clear();
+        m_IncompletePhis.clear();
+
+        // Scope 0 stands for the top level, which holds globals
+        m_Scopes.assign(2, {});
+        m_FunctionScope = 1;
+
+        m_Block = NewBlock();
+        Seal(m_Block);
+        for (size_t i = 0; i < paramTypes.size(); ++i) {
+            int variable = DeclareVariable(paramTypes[i]);
+            WriteVariable(variable, m_Block, m_Function->Append(m_Block, IROpcode::Param, paramTypes[i], {}, (int32_t)i));
+        }
+
+        LowerBlock(static_cast<TopStatements&>(*decl.GetBody()));
+        m_Function->Append(m_Block, IROpcode::Return, nullptr);
+
+        RemoveTrivialPhis();
+        m_Function = nullptr;
+        return function;
+    }
+
+    void LowerBlock(TopStatements& block) {
+        m_Scopes.emplace_back();
+        for (const auto& stat : block.GetStatements()) {
+            LowerStatement(*stat);
+        }
+        m_Scopes.pop_back();
+    }
+
+    void LowerStatement(ASTNode& stat) {
+        switch (stat.GetKind()) {
+            case ASTNodeKind::VariableDeclaration: {
+                IRValue value = LowerExpression(static_cast<VariableDeclaration&>(stat).GetInitialValue());
+                int variable = DeclareVariable((*m_Function)[value].type);
+                WriteVariable(variable, m_Block, value);
+                break;
+            }
+
+            case ASTNodeKind::ForStatement:
+                LowerForStatement(static_cast<ForStatement&>(stat));
+                break;
+
+            case ASTNodeKind::FunctionDeclaration:
+                m_Errors.push_back("nested fn " + static_cast<FunctionDeclaration&>(stat).GetName() + " is not lowered");
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    //   current: init; jump header
+    //   header:  phis; cond; br body, exit
+    //   body:    ...; jump latch
+    //   latch:   increment; jump header
+    void LowerForStatement(ForStatement& loop) {
+        m_Scopes.emplace_back();
+        LowerStatement(*loop.GetInitialization());
+
+        IRBlockId header = NewBlock();
+        Jump(header);
+
+        m_Block = header;
+        IRValue condition = LowerExpression(loop.GetCondition());
+        IRBlockId body = NewBlock();
+        IRBlockId exit = NewBlock();
+        m_Function->Append(m_Block, IROpcode::Branch, nullptr, { condition, body, exit });
+        m_Function->AddEdge(m_Block, body);
+        m_Function->AddEdge(m_Block, exit);
+        Seal(body);
+        Seal(exit);
+
+        m_Block = body;
+        LowerBlock(static_cast<TopStatements&>(*loop.GetBody()));
+
+        IRBlockId latch = NewBlock();
+        Jump(latch);
+        Seal(latch);
+        m_Block = latch;
+        LowerExpression(loop.GetIncrement());
+        Jump(header);
+        Seal(header);
+
+        m_Block = exit;
+        m_Scopes.pop_back();
+    }
+
+    // Expressions are lowered post-order on an explicit value stack so deep
+    // expression trees don't recurse
+    IRValue LowerExpression(const ASTNodeRef& expr) {
+        const size_t base = m_Values.size();
+        ASTWalker::Walk(expr,
+            [this](ASTNode& node) { return EnterExpression(node); },
+            [this](ASTNode& node) { LeaveExpression(node); });
+
+        IRValue result = m_Values.size() > base ? m_Values.back() : NoIRValue;
+        m_Values.resize(base);
+        return result;
+    }
+
+    // The target of an assignment is written, not read, so assignments are
+    // lowered as a whole on entry
+    bool EnterExpression(ASTNode& node) {
+        if (node.GetKind() != ASTNodeKind::AssignmentExpression) {
+            return true;
+        }
+
+        auto& assignment = static_cast<AssignmentExpression&>(node);
+        auto& target = static_cast<IdentifierExpression&>(*assignment.GetTarget());
+        IRValue value = LowerExpression(assignment.GetValue());
+        int variable = GetVariable(target.GetBinding());
+        if (variable < 0) {
+            m_Errors.push_back("assignment to global " + target.GetName() + " is not supported");
+        } else {
+            WriteVariable(variable, m_Block, value);
+        }
+        m_Values.push_back(value);
+        return false;
+    }
+
+    void LeaveExpression(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::IntegerLiteralExpression: {
+                auto& literal = static_cast<IntegerLiteralExpression&>(node);
+                const Type* type = m_Types.GetLiteralType(literal.GetType().name);
+                m_Values.push_back(m_Function->Append(m_Block, IROpcode::Const, type, {}, (int32_t)literal.GetValue()));
+                break;
+            }
+
+            case ASTNodeKind::IdentifierExpression:
+                m_Values.push_back(ReadIdentifier(static_cast<IdentifierExpression&>(node)));
+                break;
+
+            case ASTNodeKind::BinaryExpression: {
+                IRValue right = PopValue();
+                IRValue left = PopValue();
+                TokenType op = static_cast<BinaryExpression&>(node).GetOperator();
+                const bool isComparison = op == TokenType::LESS || op == TokenType::GREATER;
+                const Type* type = isComparison ? m_Types.Lookup("bool") : (*m_Function)[left].type;
+                m_Values.push_back(m_Function->Append(m_Block, GetBinaryOpcode(op), type, { left, right }));
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    static IROpcode GetBinaryOpcode(TokenType op) {
+        switch (op) {
+            case TokenType::PLUS: return IROpcode::Add;
+            case TokenType::MINUS: return IROpcode::Sub;
+            case TokenType::STAR: return IROpcode::Mul;
+            case TokenType::SLASH: return IROpcode::Div;
+            case TokenType::LESS: return IROpcode::Lt;
+            default: return IROpcode::Gt;
+        }
+    }
+
+    IRValue ReadIdentifier(IdentifierExpression& ident) {
+        int variable = GetVariable(ident.GetBinding());
+        if (variable >= 0) {
+            return ReadVariable(variable, m_Block);
+        }
+
+        auto it = m_GlobalTypes.find(ident.GetName());
+        const Type* type = it != m_GlobalTypes.end() ? it->second : m_Types.GetError();
+        return m_Function->Append(m_Block, IROpcode::Global, type, {}, m_Function->InternGlobal(ident.GetName()));
+    }
+
+    // Returns -1 for names bound outside the function
+    int GetVariable(const NameBinding& binding) const {
+        const int scopeIndex = (int)m_Scopes.size() - 1 - binding.depth;
+        if (binding.kind == NameBinding::Kind::Unresolved || scopeIndex < m_FunctionScope) {
+            return -1;
+        }
+        const auto& scope = m_Scopes[scopeIndex];
+        return binding.slot < (int)scope.size() ? scope[binding.slot] : -1;
+    }
+
+    int DeclareVariable(const Type* type) {
+        m_Variables.push_back(Variable{ type });
+        int variable = (int)m_Variables.size() - 1;
+        m_Scopes.back().push_back(variable);
+        return variable;
+    }
+
+    static uint64_t DefKey(int variable, IRBlockId block) {
+        return ((uint64_t)variable << 32) | block;
+    }
+
+    void WriteVariable(int variable, IRBlockId block, IRValue value) {
+        m_CurrentDefs[DefKey(variable, block)] = value;
+    }
+
+    IRValue ReadVariable(int variable, IRBlockId block) {
+        auto it = m_CurrentDefs.find(DefKey(variable, block));
+        if (it != m_CurrentDefs.end()) {
+            return it->second;
+        }
+
+        IRValue value;
+        const auto& predecessors = m_Function->GetBlocks()[block].predecessors;
+        if (!m_Sealed[block]) {
+            value = m_Function->InsertPhi(block, m_Variables[variable].type);
+            m_IncompletePhis[block].push_back(IncompletePhi{ variable, value });
+        } else if (predecessors.size() == 1) {
+            value = ReadVariable(variable, predecessors[0]);
+        } else {
+            value = m_Function->InsertPhi(block, m_Variables[variable].type);
+            WriteVariable(variable, block, value);
+            AddPhiOperands(variable, value);
+        }
+        WriteVariable(variable, block, value);
+        return value;
+    }
+
+    void AddPhiOperands(int variable, IRValue phi) {
+        const IRBlockId block = (*m_Function)[phi].block;
+        const Vector<IRBlockId> predecessors = m_Function->GetBlocks()[block].predecessors;
+
+        Vector<uint32_t> operands;
+        for (IRBlockId pred : predecessors) {
+            operands.push_back(ReadVariable(variable, pred));
+            operands.push_back(pred);
+        }
+        m_Function->SetOperands(phi, operands.data(), operands.size());
+    }
+
+    void Seal(IRBlockId block) {
+        Vector<IncompletePhi> pending = std::move(m_IncompletePhis[block]);
+        m_IncompletePhis.erase(block);
+        for (const auto& incomplete : pending) {
+            AddPhiOperands(incomplete.variable, incomplete.phi);
+        }
+        m_Sealed[block] = true;
+    }
+
+    // A phi whose operands are all one value (or itself) is that value
+    void RemoveTrivialPhis() {
+        IRFunction& function = *m_Function;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto& block : function.GetBlocks()) {
+                const Vector<IRValue> instructions = block.instructions;
+                for (IRValue value : instructions) {
+                    const IRInstruction& inst = function[value];
+                    if (inst.opcode != IROpcode::Phi) {
+                        break;
+                    }
+
+                    IRValue same = NoIRValue;
+                    bool trivial = true;
+                    for (uint32_t i = 0; i < inst.operandCount && trivial; i += 2) {
+                        IRValue operand = function.GetOperand(inst, i);
+                        if (operand == value || operand == same) continue;
+                        trivial = same == NoIRValue;
+                        same = operand;
+                    }
+
+                    if (trivial && same != NoIRValue) {
+                        function.Remove(value);
+                        function.ReplaceAllUses(value, same);
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    IRBlockId NewBlock() {
+        IRBlockId block = m_Function->AddBlock();
+        m_Sealed.push_back(false);
+        return block;
+    }
+
+    void Jump(IRBlockId target) {
+        m_Function->Append(m_Block, IROpcode::Jump, nullptr, { target });
+        m_Function->AddEdge(m_Block, target);
+    }
+
+    IRValue PopValue() {
+        IRValue value = m_Values.back();
+        m_Values.pop_back();
+        return value;
+    }
+
+    const Type* ResolveType(const String& name) const {
+        const Type* type = m_Types.Lookup(name);
+        return type ? type : m_Types.GetError();
+    }
+
+    // Top-level initializers only see literals and earlier globals
+    const Type* InferGlobalType(const ASTNodeRef& expr) {
+        Vector<const Type*> stack;
+        ASTWalker::Walk(expr,
+            [](ASTNode&) { return true; },
+            [&](ASTNode& node) {
+                switch (node.GetKind()) {
+                    case ASTNodeKind::IntegerLiteralExpression:
+                        stack.push_back(m_Types.GetLiteralType(static_cast<IntegerLiteralExpression&>(node).GetType().name));
+                        break;
+
+                    case ASTNodeKind::IdentifierExpression: {
+                        auto it = m_GlobalTypes.find(static_cast<IdentifierExpression&>(node).GetName());
+                        stack.push_back(it != m_GlobalTypes.end() ? it->second : m_Types.GetError());
+                        break;
+                    }
+
+                    case ASTNodeKind::BinaryExpression: {
+                        stack.pop_back();
+                        TokenType op = static_cast<BinaryExpression&>(node).GetOperator();
+                        if (op == TokenType::LESS || op == TokenType::GREATER) {
+                            stack.back() = m_Types.Lookup("bool");
+                        }
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+            });
+        return stack.empty() ? m_Types.GetError() : stack.back();
+    }
+
+    TypeTable& m_Types;
+    IRFunction* m_Function = nullptr;
+    IRBlockId m_Block = 0;
+    int m_FunctionScope = 0;
+
+    Vector<Variable> m_Variables;
+    Vector<Vector<int>> m_Scopes;
+    Vector<IRValue> m_Values;
+    Vector<bool> m_Sealed;
+    HashMap<uint64_t, IRValue> m_CurrentDefs;
+    HashMap<IRBlockId, Vector<IncompletePhi>> m_IncompletePhis;
+    HashMap<String, const Type*> m_GlobalTypes;
+    Vector<String> m_Errors;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "IR.h"
+#include "IRVerifier.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+// Runs a pipeline of function passes over an IRModule, timing every pass
+// (wall time summed over all functions, also recorded as a trace span) and
+// optionally re-verifying the IR after each one so a broken pass is named.
+class IRPassManager {
+public:
+    using Pass = std::function<void(IRFunction&)>;
+
+    struct PassTiming {
+        const char* name;
+        std::chrono::nanoseconds elapsed;
+    };
+
+    void Add(const char* name, Pass pass) {
+        m_Passes.push_back(Entry{ name, std::move(pass) });
+    }
+
+    void SetVerifyEach(bool verifyEach) {
+        m_VerifyEach = verifyEach;
+    }
+
+    // Returns false if verification failed after some pass
+    bool Run(IRModule& module) {
+        using Clock = std::chrono::steady_clock;
+
+        m_Timings.clear();
+        for (const auto& entry : m_Passes) {
+            TRACE_SCOPE(entry.name);
+
+            const auto start = Clock::now();
+            for (auto& function : module.functions) {
+                entry.pass(function);
+            }
+            m_Timings.push_back(PassTiming{ entry.name, Clock::now() - start });
+
+            if (m_VerifyEach) {
+                IRVerifier verifier;
+                if (!verifier.Verify(module)) {
+                    std::cerr << "IR is invalid after pass " << entry.name << std::endl;
+                    verifier.DumpErrors();
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    const Vector<PassTiming>& GetTimings() const {
+        return m_Timings;
+    }
+
+    void DumpTimings(std::ostream& out = std::cerr) const {
+        for (const auto& timing : m_Timings) {
+            out << std::setw(32) << std::left << timing.name << std::right
+                << std::setw(12) << timing.elapsed.count() / 1000.0 << " us" << std::endl;
+        }
+    }
+
+private:
+    struct Entry {
+        const char* name;
+        Pass pass;
+    };
+
+    Vector<Entry> m_Passes;
+    Vector<PassTiming> m_Timings;
+    bool m_VerifyEach = true;
+};
+
+namespace IRPasses
+{
+    // Drops instructions whose value is never used; everything but the
+    // terminators is pure, so this is always safe
+    inline void EliminateDeadValues(IRFunction& function) {
+        Vector<uint32_t> useCounts(function.GetInstructionCount(), 0);
+        for (const auto& block : function.GetBlocks()) {
+            for (IRValue value : block.instructions) {
+                const IRInstruction& inst = function[value];
+                for (uint32_t i = 0; i < inst.operandCount; ++i) {
+                    if (inst.IsValueOperand(i)) ++useCounts[function.GetOperand(inst, i)];
+                }
+            }
+        }
+
+        Vector<IRValue> worklist;
+        for (const auto& block : function.GetBlocks()) {
+            for (IRValue value : block.instructions) {
+                if (useCounts[value] == 0 && !function[value].IsTerminator()) {
+                    worklist.push_back(value);
+                }
+            }
+        }
+
+        while (!worklist.empty()) {
+            IRValue value = worklist.back();
+            worklist.pop_back();
+            if (function[value].dead) continue;
+
+            const IRInstruction& inst = function[value];
+            for (uint32_t i = 0; i < inst.operandCount; ++i) {
+                if (!inst.IsValueOperand(i)) continue;
+                IRValue operand = function.GetOperand(inst, i);
+                if (--useCounts[operand] == 0 && operand != value) {
+                    worklist.push_back(operand);
+                }
+            }
+            function.Remove(value);
+        }
+    }
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "IR.h"
+
+#include <iostream>
+#include <string>
+
+// Checks the structural SSA invariants of an IRFunction:
+//   - every block ends in exactly one terminator, and only there,
+//   - phis come first and have one incoming value per predecessor,
+//   - branch targets and predecessor lists agree,
+//   - operands name live value-producing instructions with matching types,
+//   - every definition dominates its uses (for phis: the incoming edge).
+class IRVerifier {
+public:
+    bool Verify(const IRFunction& function) {
+        m_Function = &function;
+        const size_t errorsBefore = m_Errors.size();
+
+        ComputeDominators();
+        for (IRBlockId block = 0; block < function.GetBlocks().size(); ++block) {
+            VerifyBlock(block);
+        }
+
+        m_Function = nullptr;
+        return m_Errors.size() == errorsBefore;
+    }
+
+    bool Verify(const IRModule& module) {
+        bool ok = true;
+        for (const auto& function : module.functions) {
+            ok &= Verify(function);
+        }
+        return ok;
+    }
+
+    const Vector<String>& GetErrors() const {
+        return m_Errors;
+    }
+
+    void DumpErrors(std::ostream& out = std::cerr) const {
+        for (const auto& error : m_Errors) {
+            out << "IR verifier: " << error << std::endl;
+        }
+    }
+
+private:
+    void Error(IRBlockId block, IRValue value, const char* message) {
+        String error = m_Function->GetName() + ": bb" + String(std::to_string(block).c_str());
+        if (value != NoIRValue) {
+            error += ": %" + String(std::to_string(value).c_str());
+        }
+        error += ": ";
+        error += message;
+        m_Errors.push_back(std::move(error));
+    }
+
+    void VerifyBlock(IRBlockId block) {
+        const IRFunction& function = *m_Function;
+        const auto& instructions = function.GetBlocks()[block].instructions;
+        if (instructions.empty() || !function[instructions.back()].IsTerminator()) {
+            Error(block, NoIRValue, "block does not end in a terminator");
+        }
+
+        bool phisDone = false;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const IRValue value = instructions[i];
+            const IRInstruction& inst = function[value];
+
+            if (inst.dead || inst.block != block) {
+                Error(block, value, "instruction is dead or listed in the wrong block");
+            }
+            if (inst.IsTerminator() && i + 1 != instructions.size()) {
+                Error(block, value, "terminator in the middle of a block");
+            }
+            if (inst.opcode == IROpcode::Phi) {
+                if (phisDone) Error(block, value, "phi after a non-phi instruction");
+                VerifyPhi(block, value);
+            } else {
+                phisDone = true;
+                VerifyOperands(block, value, i);
+            }
+        }
+
+        function.ForEachSuccessor(block, [&](IRBlockId successor) {
+            if (successor >= function.GetBlocks().size()) {
+                Error(block, NoIRValue, "branch to a block that doesn't exist");
+                return;
+            }
+            const auto& preds = function.GetBlocks()[successor].predecessors;
+            if (std::find(preds.begin(), preds.end(), block) == preds.end()) {
+                Error(block, NoIRValue, "successor doesn't list this block as a predecessor");
+            }
+        });
+        for (IRBlockId pred : function.GetBlocks()[block].predecessors) {
+            bool found = false;
+            function.ForEachSuccessor(pred, [&](IRBlockId successor) { found |= successor == block; });
+            if (!found) Error(block, NoIRValue, "predecessor doesn't branch here");
+        }
+    }
+
+    void VerifyPhi(IRBlockId block, IRValue value) {
+        const IRFunction& function = *m_Function;
+        const IRInstruction& inst = function[value];
+        const auto& preds = function.GetBlocks()[block].predecessors;
+
+        if (inst.operandCount != 2 * preds.size()) {
+            Error(block, value, "phi needs exactly one incoming value per predecessor");
+            return;
+        }
+        for (uint32_t i = 0; i < inst.operandCount; i += 2) {
+            const IRValue incoming = function.GetOperand(inst, i);
+            const IRBlockId from = function.GetOperand(inst, i + 1);
+            if (std::find(preds.begin(), preds.end(), from) == preds.end()) {
+                Error(block, value, "phi incoming block is not a predecessor");
+                continue;
+            }
+            if (!IsValidValue(incoming)) {
+                Error(block, value, "phi operand is not a live value");
+                continue;
+            }
+            if (function[incoming].type != inst.type) {
+                Error(block, value, "phi operand type differs from the phi");
+            }
+            // The incoming value must be available at the end of the edge's source
+            if (!Dominates(function[incoming].block, from)) {
+                Error(block, value, "phi operand doesn't dominate its incoming edge");
+            }
+        }
+    }
+
+    void VerifyOperands(IRBlockId block, IRValue value, size_t position) {
+        const IRFunction& function = *m_Function;
+        const IRInstruction& inst = function[value];
+
+        for (uint32_t i = 0; i < inst.operandCount; ++i) {
+            if (!inst.IsValueOperand(i)) {
+                continue;
+            }
+            const IRValue operand = function.GetOperand(inst, i);
+            if (!IsValidValue(operand)) {
+                Error(block, value, "operand is not a live value");
+                continue;
+            }
+
+            const IRInstruction& def = function[operand];
+            if (def.block == block) {
+                const auto& instructions = function.GetBlocks()[block].instructions;
+                auto defPosition = std::find(instructions.begin(), instructions.end(), operand) - instructions.begin();
+                if ((size_t)defPosition >= position) {
+                    Error(block, value, "operand is used before it is defined");
+                }
+            } else if (!Dominates(def.block, block)) {
+                Error(block, value, "operand definition doesn't dominate its use");
+            }
+        }
+
+        switch (inst.opcode) {
+            case IROpcode::Add:
+            case IROpcode::Sub:
+            case IROpcode::Mul:
+            case IROpcode::Div:
+            case IROpcode::Lt:
+            case IROpcode::Gt:
+                if (inst.operandCount != 2) {
+                    Error(block, value, "binary instruction needs two operands");
+                } else if (function[function.GetOperand(inst, 0)].type != function[function.GetOperand(inst, 1)].type) {
+                    Error(block, value, "binary operand types differ");
+                }
+                break;
+
+            case IROpcode::Branch:
+                if (inst.operandCount != 3) Error(block, value, "br needs a condition and two targets");
+                break;
+
+            case IROpcode::Jump:
+                if (inst.operandCount != 1) Error(block, value, "jump needs one target");
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    bool IsValidValue(IRValue value) const {
+        return value < m_Function->GetInstructionCount() && !(*m_Function)[value].dead &&
+               (*m_Function)[value].type != nullptr;
+    }
+
+    // Iterative dominators over reverse postorder (Cooper, Harvey, Kennedy)
+    void ComputeDominators() {
+        const IRFunction& function = *m_Function;
+        const size_t blockCount = function.GetBlocks().size();
+
+        m_PostOrder.assign(blockCount, -1);
+        m_ImmediateDominators.assign(blockCount, -1);
+        Vector<IRBlockId> order;
+
+        // Iterative DFS computing postorder numbers from block 0
+        Vector<std::pair<IRBlockId, Vector<IRBlockId>>> stack;
+        Vector<bool> visited(blockCount, false);
+        auto Push = [&](IRBlockId block) {
+            visited[block] = true;
+            Vector<IRBlockId> successors;
+            function.ForEachSuccessor(block, [&](IRBlockId successor) {
+                if (successor < blockCount) successors.push_back(successor);
+            });
+            stack.emplace_back(block, std::move(successors));
+        };
+        if (blockCount > 0) Push(0);
+        while (!stack.empty()) {
+            auto& [block, successors] = stack.back();
+            if (successors.empty()) {
+                m_PostOrder[block] = (int)order.size();
+                order.push_back(block);
+                stack.pop_back();
+                continue;
+            }
+            IRBlockId next = successors.back();
+            successors.pop_back();
+            if (!visited[next]) Push(next);
+        }
+
+        if (blockCount == 0) return;
+        m_ImmediateDominators[0] = 0;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto it = order.rbegin(); it != order.rend(); ++it) {
+                const IRBlockId block = *it;
+                if (block == 0) continue;
+
+                int dominator = -1;
+                for (IRBlockId pred : function.GetBlocks()[block].predecessors) {
+                    if (pred >= blockCount || m_ImmediateDominators[pred] < 0) continue;
+                    dominator = dominator < 0 ? (int)pred : Intersect((int)pred, dominator);
+                }
+                if (dominator != m_ImmediateDominators[block]) {
+                    m_ImmediateDominators[block] = dominator;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    int Intersect(int a, int b) const {
+        while (a != b) {
+            while (m_PostOrder[a] < m_PostOrder[b]) a = m_ImmediateDominators[a];
+            while (m_PostOrder[b] < m_PostOrder[a]) b = m_ImmediateDominators[b];
+        }
+        return a;
+    }
+
+    // Unreachable blocks are dominated by everything
+    bool Dominates(IRBlockId dominator, IRBlockId block) const {
+        if (m_ImmediateDominators[block] < 0) {
+            return true;
+        }
+        int current = (int)block;
+        while (true) {
+            if (current == (int)dominator) return true;
+            if (current == 0) return false;
+            current = m_ImmediateDominators[current];
+        }
+    }
+
+    const IRFunction* m_Function = nullptr;
+    Vector<int> m_PostOrder;
+    Vector<int> m_ImmediateDominators;
+    Vector<String> m_Errors;
+};
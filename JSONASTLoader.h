@@ -0,0 +1,411 @@
+#pragma once
+
+#include "ASTNode.h"
+#include "ASTNodeDefinitions.h"
+#include "CommonTypes.h"
+#include "Token.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#define COUNT_JSON_PROPERTY(TYPE, NAME) +1
+
+#define COUNT_JSON_PROPERTIES(NAME, PROPERTIES) \
+    case ASTNodeKind::NAME:                     \
+        return 0 PROPERTIES(COUNT_JSON_PROPERTY);
+
+#define READ_JSON_PROPERTY_AT(TYPE, NAME)                       \
+    if (index == property++) {                                  \
+        return ReadKey(#NAME) && ReadValue((TYPE*)nullptr);     \
+    }
+
+#define READ_JSON_PROPERTIES(NAME, PROPERTIES) \
+    case ASTNodeKind::NAME:                    \
+        PROPERTIES(READ_JSON_PROPERTY_AT)      \
+        break;
+
+#define BEGIN_JSON_NODE(NAME, PROPERTIES)                                           \
+    if (nodeType == #NAME) {                                                        \
+        m_Frames.push_back(Frame{ ASTNodeKind::NAME, 0, m_Values.size(), false });  \
+        return true;                                                                \
+    }
+
+#define TAKE_JSON_PROPERTY(TYPE, NAME) TYPE NAME = std::get<TYPE>(std::move(m_Values[next++]));
+
+#define PASS_JSON_PROPERTY(TYPE, NAME) NAME,
+
+#define BUILD_JSON_NODE(NAME, PROPERTIES)                             \
+    case ASTNodeKind::NAME: {                                         \
+        PROPERTIES(TAKE_JSON_PROPERTY)                                \
+        node = MakeShared<NAME>(PROPERTIES(PASS_JSON_PROPERTY) false); \
+        break;                                                        \
+    }
+
+#define PARSE_JSON_TOKEN_NAME(NAME)        \
+    if (name == #NAME) {                   \
+        token = TokenType::NAME;           \
+        return true;                       \
+    }
+
+// Rebuilds an AST from JSONSerializerVisitor output in a single pass over
+// the text, without an intermediate DOM: each object is read straight into
+// the node its "NodeType" names, with properties in the order the
+// serializer writes them. Anything else is reported as an error with the
+// line and column where reading stopped. Nodes being read are kept on an
+// explicit stack, with their finished properties on a value stack, so a
+// dump of a deeply nested tree loads in bounded native stack.
+class JSONASTLoader {
+public:
+    ASTNodeRef Load(std::string_view json, String& error) {
+        m_Begin = m_Cursor = json.data();
+        m_End = json.data() + json.size();
+        m_Error.clear();
+
+        ASTNodeRef root = ReadNode();
+        SkipWhitespace();
+        if (root && m_Cursor != m_End) {
+            Fail("trailing characters after the root node");
+            root = nullptr;
+        }
+        if (!root) {
+            error = m_Error;
+        }
+        return root;
+    }
+
+private:
+    using JSONValue = std::variant<ASTNodeRef, Vector<ASTNodeRef>, int, String, TokenType, NameBinding,
+                                   LiteralType, Vector<FuncParam>>;
+
+    struct Frame {
+        ASTNodeKind kind;
+        int property;       // properties started so far
+        size_t firstValue;  // where the node's properties start in m_Values
+        bool inArray;       // between the elements of a Vector<ASTNodeRef>
+    };
+
+    ASTNodeRef ReadNode() {
+        m_Frames.clear();
+        m_Values.clear();
+        if (!BeginNode()) {
+            return nullptr;
+        }
+        while (!m_Frames.empty()) {
+            if (!Step()) {
+                return nullptr;
+            }
+        }
+        return std::get<ASTNodeRef>(std::move(m_Values.back()));
+    }
+
+    // Reads up to the next child node, or finishes the node on top
+    bool Step() {
+        Frame& frame = m_Frames.back();
+        if (frame.inArray) {
+            if (ReadSeparator()) {
+                return BeginNode();
+            }
+            frame.inArray = false;
+            return Expect(']');
+        }
+        if (frame.property < PropertyCount(frame.kind)) {
+            return Expect(',') && ReadNextProperty(frame);
+        }
+        return Expect('}') && EndNode();
+    }
+
+    // Either delivers null or pushes a frame for the node being opened
+    bool BeginNode() {
+        SkipWhitespace();
+        if (ReadLiteral("null")) {
+            Deliver(nullptr);
+            return true;
+        }
+        std::string_view nodeType;
+        if (!Expect('{') || !ReadKey("NodeType") || !ReadString(nodeType)) {
+            return false;
+        }
+
+        AST_NODES_LIST(BEGIN_JSON_NODE)
+
+        return Fail("unknown NodeType");
+    }
+
+    bool EndNode() {
+        const Frame frame = m_Frames.back();
+        m_Frames.pop_back();
+
+        size_t next = frame.firstValue;
+        ASTNodeRef node;
+        switch (frame.kind) {
+            AST_NODES_LIST(BUILD_JSON_NODE)
+        }
+        m_Values.resize(frame.firstValue);
+        Deliver(std::move(node));
+        return true;
+    }
+
+    // A finished node is the next property of its parent, or the next
+    // element if the parent is in an array
+    void Deliver(ASTNodeRef node) {
+        if (!m_Frames.empty() && m_Frames.back().inArray) {
+            std::get<Vector<ASTNodeRef>>(m_Values.back()).push_back(std::move(node));
+        } else {
+            m_Values.emplace_back(std::move(node));
+        }
+    }
+
+    static int PropertyCount(ASTNodeKind kind) {
+        switch (kind) {
+            AST_NODES_LIST(COUNT_JSON_PROPERTIES)
+        }
+        return 0;
+    }
+
+    bool ReadNextProperty(Frame& frame) {
+        const int index = frame.property++;
+        int property = 0;
+        switch (frame.kind) {
+            AST_NODES_LIST(READ_JSON_PROPERTIES)
+        }
+        return Fail("unexpected property");
+    }
+
+    template <typename T>
+    bool ReadValue(T*) {
+        T value{};
+        if (!ReadProperty(value)) {
+            return false;
+        }
+        m_Values.emplace_back(std::move(value));
+        return true;
+    }
+
+    bool ReadValue(ASTNodeRef*) {
+        return BeginNode();
+    }
+
+    bool ReadValue(Vector<ASTNodeRef>*) {
+        if (!Expect('[')) {
+            return false;
+        }
+        m_Values.emplace_back(Vector<ASTNodeRef>());
+        SkipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == ']') {
+            ++m_Cursor;
+            return true;
+        }
+        m_Frames.back().inArray = true;
+        return BeginNode();
+    }
+
+    bool ReadProperty(int& value) {
+        std::string_view text;
+        if (!ReadString(text)) {
+            return false;
+        }
+        return ParseInt(text, value) || Fail("expected an integer");
+    }
+
+    bool ReadProperty(String& value) {
+        std::string_view text;
+        if (!ReadString(text)) {
+            return false;
+        }
+        value.assign(text.data(), text.size());
+        return true;
+    }
+
+    bool ReadProperty(TokenType& token) {
+        std::string_view name;
+        if (!ReadString(name)) {
+            return false;
+        }
+        TOKEN_LIST(PARSE_JSON_TOKEN_NAME)
+        return Fail("unknown token name");
+    }
+
+    bool ReadProperty(NameBinding& binding) {
+        std::string_view text;
+        if (!ReadString(text)) {
+            return false;
+        }
+        if (text == "unresolved") {
+            binding = NameBinding{};
+            return true;
+        }
+
+        std::string_view position;
+        if (text.substr(0, 6) == "local ") {
+            binding.kind = NameBinding::Kind::Local;
+            position = text.substr(6);
+        } else if (text.substr(0, 6) == "param ") {
+            binding.kind = NameBinding::Kind::Parameter;
+            position = text.substr(6);
+        } else {
+            return Fail("expected a name binding");
+        }
+
+        const size_t colon = position.find(':');
+        int depth = 0, slot = 0;
+        if (colon == std::string_view::npos || !ParseInt(position.substr(0, colon), depth) ||
+            !ParseInt(position.substr(colon + 1), slot)) {
+            return Fail("expected a name binding");
+        }
+        binding.depth = depth;
+        binding.slot = slot;
+        return true;
+    }
+
+    bool ReadProperty(LiteralType& type) {
+        return ReadProperty(type.name);
+    }
+
+    bool ReadProperty(FuncParam& param) {
+        return Expect('{') && ReadKey("Identifier") && ReadProperty(param.name) && Expect(',') &&
+               ReadKey("Type") && ReadProperty(param.type) && Expect('}');
+    }
+
+    template <typename T>
+    bool ReadProperty(Vector<T>& elements) {
+        if (!Expect('[')) {
+            return false;
+        }
+        SkipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == ']') {
+            ++m_Cursor;
+            return true;
+        }
+        do {
+            elements.emplace_back();
+            if (!ReadProperty(elements.back())) {
+                return false;
+            }
+        } while (ReadSeparator());
+        return Expect(']');
+    }
+
+    // Consumes a ',' if there is one
+    bool ReadSeparator() {
+        SkipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == ',') {
+            ++m_Cursor;
+            return true;
+        }
+        return false;
+    }
+
+    bool ReadKey(const char* key) {
+        std::string_view name;
+        if (!ReadString(name)) {
+            return false;
+        }
+        if (name != key) {
+            return Fail(String("expected key \"") + key + '"');
+        }
+        return Expect(':');
+    }
+
+    // The serializer never escapes anything, so strings are used verbatim
+    bool ReadString(std::string_view& text) {
+        if (!Expect('"')) {
+            return false;
+        }
+        const char* begin = m_Cursor;
+        const char* quote = (const char*)std::memchr(begin, '"', m_End - begin);
+        if (!quote) {
+            return Fail("unterminated string");
+        }
+        if (std::memchr(begin, '\\', quote - begin)) {
+            return Fail("escaped characters are not supported");
+        }
+        text = std::string_view(begin, quote - begin);
+        m_Cursor = quote + 1;
+        return true;
+    }
+
+    bool ReadLiteral(std::string_view literal) {
+        if ((size_t)(m_End - m_Cursor) >= literal.size() &&
+            std::memcmp(m_Cursor, literal.data(), literal.size()) == 0) {
+            m_Cursor += literal.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool Expect(char c) {
+        SkipWhitespace();
+        if (m_Cursor < m_End && *m_Cursor == c) {
+            ++m_Cursor;
+            return true;
+        }
+        return Fail(String("expected '") + c + '\'');
+    }
+
+    void SkipWhitespace() {
+        while (m_Cursor < m_End && (*m_Cursor == ' ' || *m_Cursor == '\n' || *m_Cursor == '\t' || *m_Cursor == '\r')) {
+            ++m_Cursor;
+        }
+    }
+
+    static bool ParseInt(std::string_view text, int& value) {
+        size_t i = 0;
+        const bool negative = !text.empty() && text[0] == '-';
+        i += negative;
+        if (i == text.size()) {
+            return false;
+        }
+        int64_t result = 0;
+        for (; i < text.size(); ++i) {
+            if (text[i] < '0' || text[i] > '9' || result > INT32_MAX) {
+                return false;
+            }
+            result = result * 10 + (text[i] - '0');
+        }
+        result = negative ? -result : result;
+        if (result < INT32_MIN || result > INT32_MAX) {
+            return false;
+        }
+        value = (int)result;
+        return true;
+    }
+
+    // Keeps the first error, which is where reading actually went wrong
+    bool Fail(const String& message) {
+        if (m_Error.empty()) {
+            int line = 1;
+            const char* lineBegin = m_Begin;
+            for (const char* p = m_Begin; p < m_Cursor; ++p) {
+                if (*p == '\n') {
+                    ++line;
+                    lineBegin = p + 1;
+                }
+            }
+            m_Error = std::to_string(line).c_str();
+            m_Error += ':';
+            m_Error += std::to_string(m_Cursor - lineBegin + 1).c_str();
+            m_Error += ": " + message;
+        }
+        return false;
+    }
+
+    const char* m_Begin = nullptr;
+    const char* m_Cursor = nullptr;
+    const char* m_End = nullptr;
+    String m_Error;
+    Vector<Frame> m_Frames;
+    Vector<JSONValue> m_Values;
+};
+
+#undef COUNT_JSON_PROPERTY
+#undef COUNT_JSON_PROPERTIES
+#undef READ_JSON_PROPERTY_AT
+#undef READ_JSON_PROPERTIES
+#undef BEGIN_JSON_NODE
+#undef TAKE_JSON_PROPERTY
+#undef PASS_JSON_PROPERTY
+#undef BUILD_JSON_NODE
+#undef PARSE_JSON_TOKEN_NAME
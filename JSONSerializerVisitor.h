@@ -40,6 +40,50 @@ public:
 
     AST_NODES_LIST(DEFINE_VISITOR_OVERLOADS);
 
+    // Writes a root TopStatements one statement at a time, byte for byte
+    // as Visit(const TopStatements&) would
+    void BeginTopStatements() {
+        m_Output << "{\n";
+        PushIndentLevel();
+        Indent();
+        m_Output << "\"NodeType\": \"TopStatements\"";
+        PrepareForNextElement(false);
+        m_Output << "\"Statements\": [";
+        PushIndentLevel();
+        m_StreamedStatements = 0;
+    }
+
+    void SerializeTopStatement(const ASTNodeRef& statement) {
+        if (m_StreamedStatements++ > 0) {
+            PrepareForNextElement(false);
+        } else {
+            m_Output << '\n';
+            Indent();
+        }
+        statement->Accept(*this);
+    }
+
+    // Picks up inside the Statements array after `streamed` statements
+    // were written elsewhere, e.g. by another serializer into another
+    // buffer. The output continues exactly as if they had gone through here.
+    void ResumeTopStatements(int streamed) {
+        m_IndentLevel = 2;
+        m_StreamedStatements = streamed;
+    }
+
+    void EndTopStatements() {
+        PopIndentLevel();
+        if (m_StreamedStatements > 0) {
+            m_Output << '\n';
+            Indent();
+        }
+        m_Output << ']';
+        PrepareForNextElement(true);
+        PopIndentLevel();
+        Indent();
+        m_Output << "}";
+    }
+
 private:
     void Serialize(const ASTNodeRef& expr) {
         expr->Accept(*this);
@@ -57,6 +101,24 @@ private:
         m_Output << '"' << GetTokenName(token) << '"';
     }
 
+    void Serialize(const NameBinding& binding) {
+        switch (binding.kind) {
+            case NameBinding::Kind::Unresolved:
+                m_Output << "\"unresolved\"";
+                break;
+            case NameBinding::Kind::Local:
+                m_Output << "\"local " << binding.depth << ':' << binding.slot << '"';
+                break;
+            case NameBinding::Kind::Parameter:
+                m_Output << "\"param " << binding.depth << ':' << binding.slot << '"';
+                break;
+        }
+    }
+
+    void Serialize(const LiteralType& type) {
+        Serialize(type.name);
+    }
+
     void Serialize(const Vector<ASTNodeRef>& vec) {
         SerializeVector(vec);
     }
@@ -123,6 +185,7 @@ private:
 
 private:
     int m_IndentLevel = 0;
+    int m_StreamedStatements = 0;
     std::ostream& m_Output;
 };
 
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "Result.h"
+
+#include <cstdio>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Leaner Result<T, E> for hot lexer/parser paths. Same Ok()/Err() helpers as
+// Result.h, but:
+//   - trivially copyable/destructible whenever T and E are,
+//   - no separate "initialized" flag; moves are noexcept when T's and E's are,
+//   - payloads are moved (never copied) in and, from rvalues, out,
+//   - LeanResult<void, E> needs no discriminant at all when ResultNiche<E>
+//     names a value of E that is never used as an error,
+//   - [[nodiscard]], so an ignored error is a warning.
+
+// Specialize with `static constexpr E okValue = ...;` to pack
+// LeanResult<void, E> into sizeof(E)
+template <typename E>
+struct ResultNiche {};
+
+template <typename E, typename = void>
+struct HasResultNiche : std::false_type {};
+
+template <typename E>
+struct HasResultNiche<E, std::void_t<decltype(ResultNiche<E>::okValue)>> : std::true_type {};
+
+namespace details {
+
+template <typename T, typename E>
+constexpr bool IsTrivialPayload =
+    std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T> &&
+    std::is_trivially_copyable_v<E> && std::is_trivially_destructible_v<E>;
+
+template <typename T, typename E, bool Trivial = IsTrivialPayload<T, E>>
+struct LeanStorage;
+
+template <typename T, typename E>
+struct LeanStorage<T, E, true> {
+    LeanStorage(types::Ok<T>&& ok) : value(std::move(ok.val)), ok(true) {}
+    LeanStorage(types::Err<E>&& err) : error(std::move(err.val)), ok(false) {}
+
+    union {
+        T value;
+        E error;
+    };
+    bool ok;
+};
+
+template <typename T, typename E>
+struct LeanStorage<T, E, false> {
+    static constexpr bool NothrowMove =
+        std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>;
+
+    LeanStorage(types::Ok<T>&& ok) : value(std::move(ok.val)), ok(true) {}
+    LeanStorage(types::Err<E>&& err) : error(std::move(err.val)), ok(false) {}
+
+    LeanStorage(const LeanStorage& other) {
+        ConstructFrom(other);
+    }
+
+    LeanStorage(LeanStorage&& other) noexcept(NothrowMove) {
+        ConstructFrom(std::move(other));
+    }
+
+    // Copies before destroying anything, so a throwing copy leaves *this
+    // as it was. Both assignments end in a move into the destroyed storage,
+    // which is why they need moves that can't throw.
+    LeanStorage& operator=(const LeanStorage& other) {
+        static_assert(NothrowMove, "assigning a LeanResult needs nothrow-movable payloads");
+        if (this != &other) {
+            LeanStorage copy(other);
+            Destroy();
+            ConstructFrom(std::move(copy));
+        }
+        return *this;
+    }
+
+    LeanStorage& operator=(LeanStorage&& other) noexcept {
+        static_assert(NothrowMove, "assigning a LeanResult needs nothrow-movable payloads");
+        if (this != &other) {
+            Destroy();
+            ConstructFrom(std::move(other));
+        }
+        return *this;
+    }
+
+    ~LeanStorage() {
+        Destroy();
+    }
+
+    void ConstructFrom(const LeanStorage& other) {
+        ok = other.ok;
+        if (ok) new (&value) T(other.value);
+        else new (&error) E(other.error);
+    }
+
+    void ConstructFrom(LeanStorage&& other) noexcept(NothrowMove) {
+        ok = other.ok;
+        if (ok) new (&value) T(std::move(other.value));
+        else new (&error) E(std::move(other.error));
+    }
+
+    void Destroy() {
+        if (ok) value.~T();
+        else error.~E();
+    }
+
+    union {
+        T value;
+        E error;
+    };
+    bool ok;
+};
+
+template <typename E, bool Niche = HasResultNiche<E>::value>
+struct LeanVoidStorage {
+    LeanVoidStorage(types::Ok<void>) : ok(true) {}
+    LeanVoidStorage(types::Err<E>&& err) : error(std::move(err.val)), ok(false) {}
+
+    E error{};
+    bool ok;
+};
+
+template <typename E>
+struct LeanVoidStorage<E, true> {
+    LeanVoidStorage(types::Ok<void>) : error(ResultNiche<E>::okValue) {}
+    LeanVoidStorage(types::Err<E>&& err) : error(std::move(err.val)) {}
+
+    bool IsOk() const { return error == ResultNiche<E>::okValue; }
+
+    E error;
+};
+
+[[noreturn]] inline void LeanResultPanic(const char* message) {
+    std::fprintf(stderr, "%s\n", message);
+    std::terminate();
+}
+
+} // namespace details
+
+template <typename T, typename E>
+class [[nodiscard]] LeanResult {
+public:
+    LeanResult(types::Ok<T> ok) : m_Storage(std::move(ok)) {}
+    LeanResult(types::Err<E> err) : m_Storage(std::move(err)) {}
+
+    bool isOk() const { return m_Storage.ok; }
+    bool isErr() const { return !m_Storage.ok; }
+
+    const T& value() const& { return m_Storage.value; }
+    T& value() & { return m_Storage.value; }
+    const E& error() const { return m_Storage.error; }
+
+    const T& expect(const char* message) const& {
+        if (!isOk()) details::LeanResultPanic(message);
+        return m_Storage.value;
+    }
+
+    T expect(const char* message) && {
+        if (!isOk()) details::LeanResultPanic(message);
+        return std::move(m_Storage.value);
+    }
+
+    const T& unwrap() const& {
+        return expect("Attempting to unwrap an error Result");
+    }
+
+    T unwrap() && {
+        return std::move(*this).expect("Attempting to unwrap an error Result");
+    }
+
+    T unwrapOr(T defaultValue) && {
+        return isOk() ? std::move(m_Storage.value) : std::move(defaultValue);
+    }
+
+    E unwrapErr() const {
+        if (!isErr()) details::LeanResultPanic("Attempting to unwrapErr an ok Result");
+        return m_Storage.error;
+    }
+
+private:
+    details::LeanStorage<T, E> m_Storage;
+};
+
+template <typename E>
+class [[nodiscard]] LeanResult<void, E> {
+public:
+    LeanResult(types::Ok<void> ok) : m_Storage(ok) {}
+    LeanResult(types::Err<E> err) : m_Storage(std::move(err)) {}
+
+    bool isOk() const {
+        if constexpr (HasResultNiche<E>::value) return m_Storage.IsOk();
+        else return m_Storage.ok;
+    }
+
+    bool isErr() const { return !isOk(); }
+
+    const E& error() const { return m_Storage.error; }
+
+    void expect(const char* message) const {
+        if (!isOk()) details::LeanResultPanic(message);
+    }
+
+    E unwrapErr() const {
+        if (!isErr()) details::LeanResultPanic("Attempting to unwrapErr an ok Result");
+        return m_Storage.error;
+    }
+
+private:
+    details::LeanVoidStorage<E> m_Storage;
+};
+
+namespace details {
+    enum class LeanResultCheckError : unsigned char { A, B };
+}
+
+template <>
+struct ResultNiche<details::LeanResultCheckError> {
+    static constexpr auto okValue = details::LeanResultCheckError(0xff);
+};
+
+static_assert(std::is_trivially_copyable_v<LeanResult<int, details::LeanResultCheckError>>);
+static_assert(std::is_trivially_destructible_v<LeanResult<int, details::LeanResultCheckError>>);
+static_assert(sizeof(LeanResult<int, details::LeanResultCheckError>) == 2 * sizeof(int));
+static_assert(sizeof(LeanResult<void, details::LeanResultCheckError>) == 1);
+static_assert(std::is_nothrow_move_constructible_v<LeanResult<std::vector<int>, details::LeanResultCheckError>>);
@@ -1,43 +1,104 @@
 #pragma once
 
-#include "Result.h"
+#include "LeanResult.h"
 #include "Token.h"
 #include "FileUtils.h"
 #include "Utils.h"
+#include "Trace.h"
+#include "Diagnostics.h"
+#include "Utf8.h"
 
+#include <array>
+#include <cstring>
 #include <string_view>
 #include <iostream>
 
 enum class LexError {
     NO_STREAM,
     INVALID_TOKEN,
+    INVALID_ENCODING,
 };
 
 struct Lexer {
     explicit Lexer(const char* filename)
-        : m_Stream(FileUtils::ReadFile(filename))
+        : m_Filename(filename), m_Stream(FileUtils::ReadFile(filename)),
+          m_Size(m_Stream ? (int)std::strlen(m_Stream) : 0)
+    {}
+
+    // Lexes an in-memory copy of source; filename is only used for reporting
+    Lexer(const char* filename, std::string_view source)
+        : m_Filename(filename), m_Stream(CopySource(source)), m_Size((int)std::strlen(m_Stream))
     {}
 
     ~Lexer() {
-        delete m_Stream;
+        delete[] m_Stream;
     }
 
     char Peek(int lookAhead = 0) const {
         return m_Stream[m_Offset + lookAhead];
     }
 
+    // Columns count code points, so UTF-8 continuation bytes don't advance them
     void Advance(int steps = 1) {
         for (int i = 0; i < steps; ++i) {
-            if (Peek() == '\n') {
+            const char c = Peek(i);
+            if (c == '\n') {
                 m_Location.line++;
-                m_Location.column = 0;
-            } else {
+                m_Location.column = 1;
+            } else if ((c & 0xC0) != 0x80) {
                 m_Location.column++;
             }
         }
         m_Offset += steps;
     }
 
+    // Moves to the newline ending a `//` comment, or to the end of input.
+    // The newline resets the column, so the comment isn't counted for it.
+    void SkipLineComment() {
+        const char* newline = (const char*)std::memchr(m_Stream + m_Offset, '\n', m_Size - m_Offset);
+        if (newline) {
+            m_Offset = (int)(newline - m_Stream);
+        } else {
+            SkipTo(m_Size);
+        }
+    }
+
+    // Moves past the `*/` closing a block comment. Returns false if there
+    // is none, leaving the lexer at the end of input.
+    bool SkipBlockComment() {
+        const char* end = m_Stream + m_Size;
+        const char* star = m_Stream + m_Offset + 2;
+        while ((star = (const char*)std::memchr(star, '*', end - star))) {
+            if (star + 1 < end && star[1] == '/') {
+                SkipTo((int)(star + 2 - m_Stream));
+                return true;
+            }
+            ++star;
+        }
+        SkipTo(m_Size);
+        return false;
+    }
+
+    // Advance() in bulk: newlines are found with memchr, and code points
+    // are only counted after the last one
+    void SkipTo(int offset) {
+        const char* begin = m_Stream + m_Offset;
+        const char* end = m_Stream + offset;
+        const char* lineBegin = nullptr;
+        for (const char* p = begin; (p = (const char*)std::memchr(p, '\n', end - p)); ++p) {
+            m_Location.line++;
+            lineBegin = p + 1;
+        }
+        if (lineBegin) {
+            m_Location.column = 1;
+            begin = lineBegin;
+        }
+        for (const char* p = begin; p < end; ++p) {
+            m_Location.column += (*p & 0xC0) != 0x80;
+        }
+        m_Offset = offset;
+    }
+
     void Done() {
         m_IsDone = true;
     }
@@ -50,6 +111,16 @@ struct Lexer {
         return (bool)m_Stream;
     }
 
+    // Comments are skipped unless asked for; then they come out as COMMENT
+    // tokens, for tools like the formatter that write the source back
+    void KeepComments() {
+        m_KeepComments = true;
+    }
+
+    bool IsKeepingComments() const {
+        return m_KeepComments;
+    }
+
     const std::string_view GetView(int begin, int end) const {
         return std::string_view(m_Stream + begin, end - begin);
     }
@@ -66,19 +137,110 @@ struct Lexer {
         return m_Stream;
     }
 
+    const char* GetFilename() const {
+        return m_Filename;
+    }
+
 private:
+    static char* CopySource(std::string_view source) {
+        char* buffer = new char[source.size() + 1];
+        std::memcpy(buffer, source.data(), source.size());
+        buffer[source.size()] = '\0';
+        return buffer;
+    }
+
+    const char* m_Filename = nullptr;
     const char* m_Stream = nullptr;
+    int m_Size = 0;
     int m_Offset = 0;
     Location m_Location = { 1, 1 };
     bool m_IsDone = false;
+    bool m_KeepComments = false;
 };
 
-void SkipWhitespace(Lexer& lexer) {
-    while (std::isspace(lexer.Peek())) {
-        lexer.Advance();
+// Skips whitespace along with `//` line and `/* */` block comments, which
+// don't nest
+inline void SkipWhitespace(Lexer& lexer, DiagnosticEngine& diagnostics) {
+    while (true) {
+        const char c = lexer.Peek();
+        if (std::isspace((unsigned char)c)) {
+            lexer.Advance();
+        } else if (c == '/' && (lexer.Peek(1) == '/' || lexer.Peek(1) == '*') && lexer.IsKeepingComments()) {
+            return;
+        } else if (c == '/' && lexer.Peek(1) == '/') {
+            lexer.SkipLineComment();
+        } else if (c == '/' && lexer.Peek(1) == '*') {
+            const Location begin = lexer.GetLocation();
+            if (!lexer.SkipBlockComment()) {
+                diagnostics.Error(SourceRange{ begin, lexer.GetLocation() }, "unterminated block comment");
+            }
+        } else {
+            return;
+        }
     }
 }
 
+// Checks the whole input up front so the lexer can decode UTF-8 without
+// bounds or validity checks. Reports the first invalid byte.
+inline bool ValidateEncoding(const Lexer& lexer, DiagnosticEngine& diagnostics) {
+    if (!lexer.HasStream()) {
+        return true;
+    }
+
+    const char* stream = lexer.GetStream();
+    const size_t size = std::strlen(stream);
+    const size_t invalid = Utf8::Validate(stream, size);
+    if (invalid == size) {
+        return true;
+    }
+
+    Location location = { 1, 1 };
+    for (size_t i = 0; i < invalid; ++i) {
+        if (stream[i] == '\n') {
+            location = { location.line + 1, 1 };
+        } else if ((stream[i] & 0xC0) != 0x80) {
+            location.column++;
+        }
+    }
+
+    static const char hexDigits[] = "0123456789ABCDEF";
+    const unsigned char byte = (unsigned char)stream[invalid];
+    String message = "invalid UTF-8 byte 0x";
+    message += hexDigits[byte >> 4];
+    message += hexDigits[byte & 0xF];
+    diagnostics.Error(SourceRange{ location, location }, std::move(message));
+    return false;
+}
+
+enum AsciiIdentifierClass : unsigned char {
+    IDENT_START = 1,
+    IDENT_CONTINUE = 2,
+};
+
+inline constexpr auto AsciiIdentifierClasses = [] {
+    std::array<unsigned char, 128> classes{};
+    for (int c = 0; c < 128; ++c) {
+        const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        const bool digit = c >= '0' && c <= '9';
+        classes[c] = (letter ? IDENT_START | IDENT_CONTINUE : 0) | (digit ? IDENT_CONTINUE : 0);
+    }
+    return classes;
+}();
+
+// Byte length of the identifier character at lookAhead, 0 if there is none.
+// ASCII is decided by table lookup without decoding.
+inline int GetIdentifierCharLength(const Lexer& lexer, int lookAhead, bool isStart) {
+    const unsigned char c = (unsigned char)lexer.Peek(lookAhead);
+    if (c < 0x80) {
+        return (AsciiIdentifierClasses[c] & (isStart ? IDENT_START : IDENT_CONTINUE)) ? 1 : 0;
+    }
+
+    char32_t codePoint;
+    const int length = Utf8::Decode(lexer.GetStream() + lexer.GetOffset() + lookAhead, codePoint);
+    const bool accepted = isStart ? Utf8::IsXIDStart(codePoint) : Utf8::IsXIDContinue(codePoint);
+    return accepted ? length : 0;
+}
+
 template <TokenType T>
 static constexpr bool AlwaysFalse = false;
 
@@ -88,42 +250,61 @@ bool TryParseToken(Lexer& lexer, Token& token) {
     return false;
 }
 
-#define GENERATE_MONOSTATE_TOKEN_PARSING_FUNCTIONS(TOKEN_STRING, TOKEN_NAME) \
-    template <>                                                              \
-    bool TryParseToken<TokenType::TOKEN_NAME>(Lexer& lexer, Token& token) {  \
-        const size_t len = STR_LIT_LEN(TOKEN_STRING);                        \
-        for (size_t i = 0; i < len; ++i) {                                   \
-            if (lexer.Peek(i) != (TOKEN_STRING)[i]) {                        \
-                return false;                                                \
-            }                                                                \
-        }                                                                    \
-        lexer.Advance(len);                                                  \
-        token = CreateToken<TokenType::TOKEN_NAME>(lexer.GetLocation());     \
-        return true;                                                         \
+// Keeps keywords from matching the start of a longer identifier ("format")
+template <size_t N>
+bool IsKeywordPrefix(const char (&tokenString)[N], const Lexer& lexer, int length) {
+    return std::isalpha(tokenString[0]) && GetIdentifierCharLength(lexer, length, false) > 0;
+}
+
+#define GENERATE_MONOSTATE_TOKEN_PARSING_FUNCTIONS(TOKEN_STRING, TOKEN_NAME)       \
+    template <>                                                                    \
+    inline bool TryParseToken<TokenType::TOKEN_NAME>(Lexer& lexer, Token& token) { \
+        const size_t len = STR_LIT_LEN(TOKEN_STRING);                              \
+        for (size_t i = 0; i < len; ++i) {                                         \
+            if (lexer.Peek(i) != (TOKEN_STRING)[i]) {                              \
+                return false;                                                      \
+            }                                                                      \
+        }                                                                          \
+        if (IsKeywordPrefix(TOKEN_STRING, lexer, len)) {                           \
+            return false;                                                          \
+        }                                                                          \
+        lexer.Advance(len);                                                        \
+        token = CreateToken<TokenType::TOKEN_NAME>(lexer.GetLocation());           \
+        return true;                                                               \
     }
 
 MONOSTATE_TOKEN_LIST(GENERATE_MONOSTATE_TOKEN_PARSING_FUNCTIONS)
 #undef GENERATE_MONOSTATE_TOKEN_PARSING_FUNCTIONS
 
+// XID_Start XID_Continue*, as UTF-8 bytes
 template <>
-bool TryParseToken<TokenType::IDENTIFIER>(Lexer& lexer, Token& token) {
-    if (!std::isalpha(lexer.Peek()) && lexer.Peek() != '_') {
+inline bool TryParseToken<TokenType::IDENTIFIER>(Lexer& lexer, Token& token) {
+    int length = GetIdentifierCharLength(lexer, 0, true);
+    if (length == 0) {
         return false;
     }
 
-    String value = "";
-
-    while (std::isalnum(lexer.Peek()) || lexer.Peek() == '_') {
-        value.push_back(lexer.Peek());
-        lexer.Advance();
+    while (true) {
+        const unsigned char c = (unsigned char)lexer.Peek(length);
+        if (c < 0x80) {
+            if (!(AsciiIdentifierClasses[c] & IDENT_CONTINUE)) break;
+            ++length;
+        } else if (int next = GetIdentifierCharLength(lexer, length, false)) {
+            length += next;
+        } else {
+            break;
+        }
     }
 
+    String value = String(lexer.GetView(lexer.GetOffset(), lexer.GetOffset() + length));
+    lexer.Advance(length);
+
     token = CreateTokenData<TokenType::IDENTIFIER>(std::move(value), lexer.GetLocation());
     return true;
 }
 
 template <>
-bool TryParseToken<TokenType::INT_LITERAL>(Lexer& lexer, Token& token) {
+inline bool TryParseToken<TokenType::INT_LITERAL>(Lexer& lexer, Token& token) {
     int value = 0;
     int litLen = 0;
     while (lexer.Peek(litLen) >= '0' && lexer.Peek(litLen) <= '9') {
@@ -133,7 +314,7 @@ bool TryParseToken<TokenType::INT_LITERAL>(Lexer& lexer, Token& token) {
     }
 
     // Currently we disallow letters after the integer expression
-    if (litLen == 0 || std::isalpha(lexer.Peek(litLen))) {
+    if (litLen == 0 || std::isalpha((unsigned char)lexer.Peek(litLen))) {
         return false;
     }
 
@@ -143,27 +324,30 @@ bool TryParseToken<TokenType::INT_LITERAL>(Lexer& lexer, Token& token) {
 }
 
 template <>
-bool TryParseToken<TokenType::STR_LITERAL>(Lexer& lexer, Token& token) {
+inline bool TryParseToken<TokenType::STR_LITERAL>(Lexer& lexer, Token& token) {
     if (lexer.Peek() != '"') {
         return false;
     }
 
-    lexer.Advance();
-
-    int begin = lexer.GetOffset();
-    while (lexer.Peek() != '"') {
-        lexer.Advance();
+    // Unterminated literals are left for the caller to report
+    int litLen = 1;
+    while (lexer.Peek(litLen) != '"') {
+        if (lexer.Peek(litLen) == '\0') {
+            return false;
+        }
+        ++litLen;
     }
 
-    String value = std::string(lexer.GetView(begin, lexer.GetOffset()));
-    lexer.Advance();
+    int begin = lexer.GetOffset() + 1;
+    String value = String(lexer.GetView(begin, begin + litLen - 1));
+    lexer.Advance(litLen + 1);
 
     token = CreateTokenData<TokenType::STR_LITERAL>(std::move(value), lexer.GetLocation());
     return true;
 }
 
 template <>
-bool TryParseToken<TokenType::END_OF_FILE>(Lexer& lexer, Token& token) {
+inline bool TryParseToken<TokenType::END_OF_FILE>(Lexer& lexer, Token& token) {
     bool reachedEOF =  !lexer.HasStream() || lexer.Peek() == '\0';
     if (reachedEOF) {
         token = CreateToken<TokenType::END_OF_FILE>(lexer.GetLocation());
@@ -176,40 +360,116 @@ bool TryParseToken<TokenType::END_OF_FILE>(Lexer& lexer, Token& token) {
 // Not sure if I need this but it will hopefully get optimized out
 // Currently exists because of the static assert
 template <>
-bool TryParseToken<TokenType::INVALID>(Lexer& lexer, Token& token) {
+inline bool TryParseToken<TokenType::INVALID>(Lexer& lexer, Token& token) {
     return false;
 }
 
-bool TryParseNextToken(Lexer& lexer, Token& token) {
+// Comments are lexed by TryParseComment, which needs the diagnostics
+template <>
+inline bool TryParseToken<TokenType::COMMENT>(Lexer&, Token&) {
+    return false;
+}
+
+// Lexes a comment into a COMMENT token holding its text, delimiters
+// included, if the lexer keeps comments
+inline bool TryParseComment(Lexer& lexer, Token& token, DiagnosticEngine& diagnostics) {
+    if (!lexer.IsKeepingComments() || lexer.Peek() != '/') {
+        return false;
+    }
+
+    const Location begin = lexer.GetLocation();
+    const int beginOffset = lexer.GetOffset();
+    int endOffset;
+    if (lexer.Peek(1) == '/') {
+        lexer.SkipLineComment();
+        endOffset = lexer.GetOffset();
+        while (endOffset > beginOffset && std::isspace((unsigned char)lexer.GetStream()[endOffset - 1])) {
+            --endOffset;
+        }
+    } else if (lexer.Peek(1) == '*') {
+        if (!lexer.SkipBlockComment()) {
+            diagnostics.Error(SourceRange{ begin, lexer.GetLocation() }, "unterminated block comment");
+        }
+        endOffset = lexer.GetOffset();
+    } else {
+        return false;
+    }
+
+    const std::string_view text = lexer.GetView(beginOffset, endOffset);
+    token = CreateTokenData<TokenType::COMMENT>(String(text.data(), text.size()), begin);
+    return true;
+}
+
+inline bool TryParseNextToken(Lexer& lexer, Token& token) {
 #define TRY_PARSE_TOKEN(NAME) || TryParseToken<TokenType::NAME>(lexer, token)
     return false
         TOKEN_LIST(TRY_PARSE_TOKEN);
 }
 
-auto Tokenize(Lexer& lexer) -> Result<TokenList, LexError> {
+// Skips the rest of an invalid token up to the next whitespace
+inline void SkipInvalidToken(Lexer& lexer, DiagnosticEngine& diagnostics) {
+    const Location begin = lexer.GetLocation();
+    const int beginOffset = lexer.GetOffset();
+    do {
+        lexer.Advance();
+    } while (lexer.Peek() != '\0' && !std::isspace((unsigned char)lexer.Peek()));
+
+    String message = "invalid token '";
+    message += lexer.GetView(beginOffset, lexer.GetOffset());
+    message += "'";
+    diagnostics.Error(SourceRange{ begin, lexer.GetLocation() }, std::move(message));
+}
+
+// Pulls the next token, so consumers that only stream over the tokens don't
+// need the whole TokenList. Returns false once END_OF_FILE has been produced.
+inline bool LexNextToken(Lexer& lexer, Token& token, DiagnosticEngine& diagnostics) {
+    while (!lexer.IsDone()) {
+        SkipWhitespace(lexer, diagnostics);
+
+        const Location begin = lexer.GetLocation();
+        if (TryParseComment(lexer, token, diagnostics) || TryParseNextToken(lexer, token)) {
+            token.location = begin;
+            token.endLocation = lexer.GetLocation();
+            return true;
+        }
+        SkipInvalidToken(lexer, diagnostics);
+    }
+    return false;
+}
+
+// Invalid input is reported to diagnostics and skipped, so the
+// returned tokens are everything that could be lexed
+inline auto Tokenize(Lexer& lexer, DiagnosticEngine& diagnostics) -> LeanResult<TokenList, LexError> {
+    TRACE_SCOPE_FILE("Tokenize", lexer.GetFilename());
+    MEM_STATS_PHASE("Tokenize");
+
     if (!lexer.HasStream()) {
         return Err(LexError::NO_STREAM);
     }
+    if (!ValidateEncoding(lexer, diagnostics)) {
+        return Err(LexError::INVALID_ENCODING);
+    }
 
     TokenList tokens;
     Token token;
-
-    while (!lexer.IsDone()) {
-        SkipWhitespace(lexer);
-
-        if (TryParseNextToken(lexer, token)) {
-            tokens.push_back(token);
-        } else {
-            const char* tokenName = GetTokenName(tokens.back().type);
-            std::cout << "Last parsed token: " << tokenName << std::endl;
-            return Err(LexError::INVALID_TOKEN);
-        }
+    while (LexNextToken(lexer, token, diagnostics)) {
+        tokens.push_back(std::move(token));
     }
 
     return Ok(std::move(tokens));
 }
 
-void PrintTokens(const Vector<Token>& tokens) {
+inline auto Tokenize(Lexer& lexer) -> LeanResult<TokenList, LexError> {
+    DiagnosticEngine diagnostics;
+    auto tokens = Tokenize(lexer, diagnostics);
+    if (tokens.isOk() && diagnostics.HasErrors()) {
+        diagnostics.Dump(std::cerr, lexer.GetFilename());
+        return Err(LexError::INVALID_TOKEN);
+    }
+    return tokens;
+}
+
+inline void PrintTokens(const Vector<Token>& tokens) {
 #define CASE(NAME)                                   \
     case TokenType::NAME:                            \
         std::cout << #NAME << ' ';                   \
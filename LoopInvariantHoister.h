@@ -0,0 +1,281 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+#include "NameResolver.h"
+
+#include <algorithm>
+#include <string>
+
+// Moves loop-invariant work in front of for loops. A body `let` whose
+// initializer only reads values fixed for the whole loop is hoisted as is;
+// remaining maximal invariant subexpressions of the condition, the increment
+// and body initializers are computed once into `$licm<N>` temporaries.
+// Expressions are pure, so the only hazard is a trapping division, which is
+// hoisted only by a nonzero literal. Loops are visited innermost first in
+// one pass, so what an inner loop hoists into an enclosing body can move on
+// when the enclosing loop is visited. Identifiers are tracked by the
+// declaration they resolve to, which moving code doesn't change, so names
+// are only resolved once before the pass and once after it.
+class LoopInvariantHoister {
+public:
+    void Run(const ASTNodeRef& root) {
+        NameResolver{}.Resolve(root);
+        CollectDeclaredNames(root);
+        CollectDeclarations(root);
+
+        ASTWalker::Walk(root,
+            [](ASTNode&) { return true; },
+            [this](ASTNode& node) {
+                if (node.GetKind() == ASTNodeKind::TopStatements) {
+                    HoistFromLoopsIn(static_cast<TopStatements&>(node));
+                }
+            });
+
+        NameResolver{}.Resolve(root);
+        m_Declarations.clear();
+    }
+
+    int GetHoistedBindingCount() const {
+        return m_HoistedBindings;
+    }
+
+    int GetHoistedExpressionCount() const {
+        return m_HoistedExpressions;
+    }
+
+private:
+    // A VariableDeclaration, or a FuncParam for parameters; nullptr for
+    // names that didn't resolve
+    using Declaration = const void*;
+
+    void CollectDeclaredNames(const ASTNodeRef& root) {
+        ASTWalker::ForEachNode(root, [this](ASTNode& node) {
+            if (node.GetKind() == ASTNodeKind::VariableDeclaration) {
+                ++m_DeclarationCounts[static_cast<VariableDeclaration&>(node).GetName()];
+            } else if (node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+                auto& function = static_cast<FunctionDeclaration&>(node);
+                m_DeclarationCounts[function.GetName()] += 2;
+                for (const auto& param : function.GetParameters()) {
+                    ++m_DeclarationCounts[param.name];
+                }
+            }
+        });
+    }
+
+    // Maps each identifier to its declaration, finding the declaration from
+    // the (depth, slot) binding the same way NameResolver numbered it
+    void CollectDeclarations(const ASTNodeRef& root) {
+        Vector<Vector<Declaration>> scopes;
+        auto OpensScope = [](ASTNodeKind kind) {
+            return kind == ASTNodeKind::TopStatements || kind == ASTNodeKind::ForStatement;
+        };
+
+        ASTWalker::Walk(root,
+            [&](ASTNode& node) {
+                if (OpensScope(node.GetKind())) {
+                    scopes.emplace_back();
+                } else if (node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+                    auto& params = scopes.emplace_back();
+                    for (const auto& param : static_cast<FunctionDeclaration&>(node).GetParameters()) {
+                        params.push_back(&param);
+                    }
+                } else if (node.GetKind() == ASTNodeKind::IdentifierExpression) {
+                    const NameBinding& binding = static_cast<IdentifierExpression&>(node).GetBinding();
+                    const int scopeIndex = (int)scopes.size() - 1 - binding.depth;
+                    Declaration declaration = nullptr;
+                    if (binding.kind != NameBinding::Kind::Unresolved && scopeIndex >= 0 &&
+                        binding.slot < (int)scopes[scopeIndex].size()) {
+                        declaration = scopes[scopeIndex][binding.slot];
+                    }
+                    m_Declarations[&node] = declaration;
+                }
+                return true;
+            },
+            [&](ASTNode& node) {
+                if (OpensScope(node.GetKind()) || node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+                    scopes.pop_back();
+                } else if (node.GetKind() == ASTNodeKind::VariableDeclaration && !scopes.empty()) {
+                    scopes.back().push_back(&node);
+                }
+            });
+    }
+
+    // Inner blocks are done by the time their enclosing block is, so each
+    // loop here already holds what its own inner loops hoisted
+    void HoistFromLoopsIn(TopStatements& block) {
+        auto& statements = block.GetStatements();
+        Vector<ASTNodeRef> result;
+        result.reserve(statements.size());
+        for (auto& stat : statements) {
+            if (stat->GetKind() == ASTNodeKind::ForStatement) {
+                HoistFrom(static_cast<ForStatement&>(*stat), result);
+            }
+            result.push_back(std::move(stat));
+        }
+        statements = std::move(result);
+    }
+
+    void ClassifyReferences(ForStatement& loop) {
+        m_LoopDeclarations.clear();
+        m_BodyDeclarations.clear();
+        m_Assigned.clear();
+
+        for (const auto& stat : static_cast<TopStatements&>(*loop.GetBody()).GetStatements()) {
+            if (stat->GetKind() == ASTNodeKind::VariableDeclaration) {
+                m_BodyDeclarations.insert(stat.get());
+            }
+        }
+
+        // Declarations come before their uses, so walk order is enough
+        ASTWalker::ForEachNode(loop.GetInitialization(), [&](ASTNode& node) { CollectLoopDeclaration(node); });
+        for (auto* part : { &loop.GetCondition(), &loop.GetIncrement(), &loop.GetBody() }) {
+            ASTWalker::ForEachNode(*part, [&](ASTNode& node) { CollectLoopDeclaration(node); });
+        }
+    }
+
+    void CollectLoopDeclaration(ASTNode& node) {
+        if (node.GetKind() == ASTNodeKind::VariableDeclaration) {
+            m_LoopDeclarations.insert(&node);
+        } else if (node.GetKind() == ASTNodeKind::FunctionDeclaration) {
+            for (const auto& param : static_cast<FunctionDeclaration&>(node).GetParameters()) {
+                m_LoopDeclarations.insert(&param);
+            }
+        } else if (node.GetKind() == ASTNodeKind::AssignmentExpression) {
+            m_Assigned.insert(m_Declarations.at(static_cast<AssignmentExpression&>(node).GetTarget().get()));
+        }
+    }
+
+    // Decides invariance for every node under expr in one post-order walk,
+    // children before their parent, and returns whether expr is invariant
+    bool IsInvariant(const ASTNodeRef& expr) {
+        if (!expr) {
+            return true;
+        }
+
+        m_Invariant.clear();
+        ASTWalker::Walk(expr,
+            [](ASTNode&) { return true; },
+            [this](ASTNode& node) {
+                bool invariant = false;
+                switch (node.GetKind()) {
+                    case ASTNodeKind::IntegerLiteralExpression:
+                        invariant = true;
+                        break;
+
+                    case ASTNodeKind::IdentifierExpression: {
+                        const Declaration declaration = m_Declarations.at(&node);
+                        if (!m_LoopDeclarations.count(declaration)) {
+                            invariant = !m_Assigned.count(declaration);
+                        } else if (m_BodyDeclarations.count(declaration)) {
+                            invariant = m_HoistedDeclarations.count(declaration) > 0;
+                        }
+                        break;
+                    }
+
+                    case ASTNodeKind::BinaryExpression: {
+                        auto& binary = static_cast<BinaryExpression&>(node);
+                        invariant = !MayTrap(binary) && m_Invariant.at(binary.GetLeft().get()) &&
+                                    m_Invariant.at(binary.GetRight().get());
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+                m_Invariant[&node] = invariant;
+            });
+        return m_Invariant.at(expr.get());
+    }
+
+    static bool MayTrap(const BinaryExpression& expr) {
+        if (expr.GetOperator() != TokenType::SLASH) {
+            return false;
+        }
+        const ASTNodeRef& divisor = expr.GetRight();
+        return divisor->GetKind() != ASTNodeKind::IntegerLiteralExpression ||
+               static_cast<IntegerLiteralExpression&>(*divisor).GetValue() == 0;
+    }
+
+    // Replaces the largest invariant binary subtrees under expr with
+    // temporaries, searching top-down from the root with an explicit stack
+    void HoistSubexpressions(ASTNodeRef& expr, Vector<ASTNodeRef>& hoisted) {
+        IsInvariant(expr);
+
+        Vector<ASTNodeRef*> stack{ &expr };
+        while (!stack.empty()) {
+            ASTNodeRef& node = *stack.back();
+            stack.pop_back();
+            if (!node || node->GetKind() != ASTNodeKind::BinaryExpression) {
+                continue;
+            }
+
+            if (m_Invariant.at(node.get())) {
+                String name = "$licm" + String(std::to_string(m_NextTemporary++).c_str());
+                m_DeclarationCounts[name] = 1;
+                auto declaration = MakeShared<VariableDeclaration>(name, node);
+                node = MakeShared<IdentifierExpression>(name, NameBinding{});
+                m_Declarations[node.get()] = declaration.get();
+                hoisted.push_back(std::move(declaration));
+                ++m_HoistedExpressions;
+                continue;
+            }
+
+            // Reversed so subtrees are hoisted left to right
+            const size_t firstChild = stack.size();
+            ASTWalker::ForEachChild(*node, [&](ASTNodeRef& child) {
+                stack.push_back(&child);
+            });
+            std::reverse(stack.begin() + firstChild, stack.end());
+        }
+    }
+
+    // Appends what gets hoisted out of loop to hoisted
+    void HoistFrom(ForStatement& loop, Vector<ASTNodeRef>& hoisted) {
+        ClassifyReferences(loop);
+        m_HoistedDeclarations.clear();
+
+        auto& body = static_cast<TopStatements&>(*loop.GetBody()).GetStatements();
+        Vector<ASTNodeRef> remaining;
+        for (auto& stat : body) {
+            if (stat->GetKind() != ASTNodeKind::VariableDeclaration) {
+                remaining.push_back(std::move(stat));
+                continue;
+            }
+
+            auto& decl = static_cast<VariableDeclaration&>(*stat);
+            const bool uniqueName = m_DeclarationCounts[decl.GetName()] == 1;
+            const bool assigned = m_Assigned.count(&decl) > 0;
+            if (uniqueName && !assigned && IsInvariant(decl.GetInitialValue())) {
+                m_HoistedDeclarations.insert(&decl);
+                hoisted.push_back(std::move(stat));
+                ++m_HoistedBindings;
+            } else {
+                remaining.push_back(std::move(stat));
+            }
+        }
+        body = std::move(remaining);
+
+        HoistSubexpressions(loop.GetCondition(), hoisted);
+        if (loop.GetIncrement()->GetKind() == ASTNodeKind::AssignmentExpression) {
+            HoistSubexpressions(static_cast<AssignmentExpression&>(*loop.GetIncrement()).GetValue(), hoisted);
+        }
+        for (auto& stat : body) {
+            if (stat->GetKind() == ASTNodeKind::VariableDeclaration) {
+                HoistSubexpressions(static_cast<VariableDeclaration&>(*stat).GetInitialValue(), hoisted);
+            }
+        }
+    }
+
+    HashMap<String, int> m_DeclarationCounts;
+    HashMap<const ASTNode*, Declaration> m_Declarations;
+    HashSet<Declaration> m_LoopDeclarations;
+    HashSet<Declaration> m_BodyDeclarations;
+    HashSet<Declaration> m_Assigned;
+    HashSet<Declaration> m_HoistedDeclarations;
+    HashMap<const ASTNode*, bool> m_Invariant;
+    int m_NextTemporary = 0;
+    int m_HoistedBindings = 0;
+    int m_HoistedExpressions = 0;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <ostream>
+
+#include "Utils.h"
+
+// Allocation accounting for the container aliases in CommonTypes.h.
+// Opt-in: build with -DZIX_ENABLE_MEM_STATS=1 to route String, Vector,
+// HashMap, HashSet and MakeShared through TrackingAllocator.
+//
+// Every allocation is tagged with the phase and node kind it was made
+// under, and freeing it takes its bytes back off those, so a row's live
+// bytes are what that phase or kind allocated and hasn't freed yet.
+#ifndef ZIX_ENABLE_MEM_STATS
+#define ZIX_ENABLE_MEM_STATS 0
+#endif
+
+namespace MemStats
+{
+    struct Counters {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<int64_t> liveBytes = 0;
+        std::atomic<int64_t> peakLiveBytes = 0;
+    };
+
+    // Stored in front of each tracked allocation
+    struct AllocationTag {
+        Counters* phase;
+        Counters* nodeKind;
+    };
+
+    // Small fixed tables keyed by string literal; slots are claimed
+    // with a CAS so recording never takes a lock.
+    struct Table {
+        static constexpr size_t Capacity = 64;
+
+        Counters* Find(const char* name) {
+            for (auto& slot : slots) {
+                const char* current = slot.name.load(std::memory_order_acquire);
+                if (current == nullptr) {
+                    if (slot.name.compare_exchange_strong(current, name, std::memory_order_acq_rel)) {
+                        return &slot;
+                    }
+                }
+                if (current == name || std::strcmp(current, name) == 0) {
+                    return &slot;
+                }
+            }
+            return nullptr;
+        }
+
+        Counters slots[Capacity];
+    };
+
+    struct Registry {
+        Table phases;
+        Table nodeKinds;
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<int64_t> liveBytes = 0;
+        std::atomic<int64_t> peakLiveBytes = 0;
+    };
+
+    inline Registry& GetRegistry() {
+        static Registry registry;
+        return registry;
+    }
+
+    inline const char*& CurrentPhase() {
+        thread_local const char* phase = "<unattributed>";
+        return phase;
+    }
+
+    inline const char*& CurrentNodeKind() {
+        thread_local const char* kind = nullptr;
+        return kind;
+    }
+
+    inline void UpdatePeak(std::atomic<int64_t>& peak, int64_t value) {
+        int64_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    inline Counters* Record(Counters* counters, size_t bytes) {
+        if (!counters) return nullptr;
+        counters->allocations.fetch_add(1, std::memory_order_relaxed);
+        counters->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        const int64_t live = counters->liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        UpdatePeak(counters->peakLiveBytes, live);
+        return counters;
+    }
+
+    inline AllocationTag RecordAllocation(size_t bytes) {
+        Registry& registry = GetRegistry();
+        registry.allocations.fetch_add(1, std::memory_order_relaxed);
+        registry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        int64_t live = registry.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        UpdatePeak(registry.peakLiveBytes, live);
+
+        AllocationTag tag{ Record(registry.phases.Find(CurrentPhase()), bytes), nullptr };
+        if (const char* kind = CurrentNodeKind()) {
+            tag.nodeKind = Record(registry.nodeKinds.Find(kind), bytes);
+        }
+        return tag;
+    }
+
+    inline void RecordDeallocation(const AllocationTag& tag, size_t bytes) {
+        GetRegistry().liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        for (Counters* counters : { tag.phase, tag.nodeKind }) {
+            if (counters) {
+                counters->liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Attributes allocations made on this thread to NAME until the scope ends
+    template <const char*& (*Current)()>
+    struct AttributionScope {
+        explicit AttributionScope(const char* name)
+            : m_Previous(Current())
+        {
+            Current() = name;
+        }
+
+        ~AttributionScope() {
+            Current() = m_Previous;
+        }
+
+    private:
+        const char* m_Previous;
+    };
+
+    using PhaseScope = AttributionScope<CurrentPhase>;
+    using NodeKindScope = AttributionScope<CurrentNodeKind>;
+
+    // Specialized per AST node in ASTNode.h so MakeShared can attribute
+    // a node's allocation (and the copies its constructor makes) to its kind
+    template <typename T>
+    inline const char* NodeKindName = nullptr;
+
+    inline void DumpTable(std::ostream& out, const char* title, const Table& table) {
+        out << std::left << std::setw(28) << title
+            << std::right << std::setw(14) << "allocations"
+            << std::setw(16) << "bytes"
+            << std::setw(18) << "peak live bytes" << '\n';
+
+        for (const auto& slot : table.slots) {
+            const char* name = slot.name.load();
+            if (!name) break;
+            out << std::left << std::setw(28) << name
+                << std::right << std::setw(14) << slot.allocations.load()
+                << std::setw(16) << slot.bytes.load()
+                << std::setw(18) << slot.peakLiveBytes.load() << '\n';
+        }
+        out << '\n';
+    }
+
+    inline void Dump(std::ostream& out) {
+        Registry& registry = GetRegistry();
+        out << "Memory statistics:\n";
+        DumpTable(out, "Phase", registry.phases);
+        DumpTable(out, "AST node kind", registry.nodeKinds);
+        out << "Total: " << registry.allocations.load() << " allocations, "
+            << registry.bytes.load() << " bytes, peak live "
+            << registry.peakLiveBytes.load() << " bytes\n";
+    }
+}
+
+template <typename T>
+struct TrackingAllocator {
+    using value_type = T;
+
+    TrackingAllocator() = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>&) {}
+
+    // The tag sits in front of the elements, padded to keep them aligned
+    static constexpr size_t Alignment = std::max(alignof(T), alignof(std::max_align_t));
+    static constexpr size_t TagSize = (sizeof(MemStats::AllocationTag) + Alignment - 1) / Alignment * Alignment;
+
+    T* allocate(size_t count) {
+        char* block = static_cast<char*>(::operator new(TagSize + count * sizeof(T), std::align_val_t(Alignment)));
+        new (block) MemStats::AllocationTag(MemStats::RecordAllocation(count * sizeof(T)));
+        return reinterpret_cast<T*>(block + TagSize);
+    }
+
+    void deallocate(T* ptr, size_t count) {
+        char* block = reinterpret_cast<char*>(ptr) - TagSize;
+        MemStats::RecordDeallocation(*reinterpret_cast<MemStats::AllocationTag*>(block), count * sizeof(T));
+        ::operator delete(block, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U>&) const { return false; }
+};
+
+#if ZIX_ENABLE_MEM_STATS
+#define MEM_STATS_PHASE(NAME) MemStats::PhaseScope DEFER_2(_mem_phase_, __LINE__)(NAME)
+#else
+#define MEM_STATS_PHASE(NAME)
+#endif
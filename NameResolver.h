@@ -0,0 +1,122 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+
+#include <iostream>
+
+// Binds every IdentifierExpression to the local slot or parameter it refers
+// to, so later passes index by (depth, slot) instead of looking names up.
+// Blocks (TopStatements, ForStatement) and function parameter lists each
+// open a scope; a let binding is visible from the statement after it.
+class NameResolver {
+public:
+    void Resolve(const ASTNodeRef& root) {
+        ASTWalker::Walk(root,
+            [this](ASTNode& node) { Enter(node); return true; },
+            [this](ASTNode& node) { Leave(node); });
+    }
+
+    // Resolves a program one top-level statement at a time, in order, with
+    // the same result as Resolve() on the whole TopStatements
+    void BeginTopLevel() {
+        m_Scopes.emplace_back();
+    }
+
+    void ResolveTopLevelStatement(const ASTNodeRef& statement) {
+        Resolve(statement);
+    }
+
+    void EndTopLevel() {
+        m_Scopes.pop_back();
+    }
+
+    const Vector<String>& GetUndefinedNames() const {
+        return m_UndefinedNames;
+    }
+
+    void DumpErrors(std::ostream& out = std::cerr) const {
+        for (const auto& name : m_UndefinedNames) {
+            out << "Undefined name: " << name << std::endl;
+        }
+    }
+
+private:
+    struct Scope {
+        HashMap<String, int> slots;
+        int slotCount = 0;
+        bool isFunction = false;
+    };
+
+    void Enter(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+                m_Scopes.emplace_back();
+                break;
+
+            case ASTNodeKind::FunctionDeclaration: {
+                Scope& scope = m_Scopes.emplace_back();
+                scope.isFunction = true;
+                for (const auto& param : static_cast<FunctionDeclaration&>(node).GetParameters()) {
+                    Declare(scope, param.name);
+                }
+                break;
+            }
+
+            case ASTNodeKind::IdentifierExpression:
+                Bind(static_cast<IdentifierExpression&>(node));
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void Leave(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+            case ASTNodeKind::FunctionDeclaration:
+                m_Scopes.pop_back();
+                break;
+
+            // Declared on leave so the initializer can't see the new binding
+            case ASTNodeKind::VariableDeclaration:
+                if (!m_Scopes.empty()) {
+                    Declare(m_Scopes.back(), static_cast<VariableDeclaration&>(node).GetName());
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    static void Declare(Scope& scope, const String& name) {
+        scope.slots[name] = scope.slotCount++;
+    }
+
+    void Bind(IdentifierExpression& ident) {
+        NameBinding& binding = ident.GetBinding();
+        binding = NameBinding{};
+
+        const int innermost = (int)m_Scopes.size() - 1;
+        for (int i = innermost; i >= 0; --i) {
+            const Scope& scope = m_Scopes[i];
+            auto it = scope.slots.find(ident.GetName());
+            if (it != scope.slots.end()) {
+                binding.kind = scope.isFunction ? NameBinding::Kind::Parameter : NameBinding::Kind::Local;
+                binding.depth = innermost - i;
+                binding.slot = it->second;
+                return;
+            }
+        }
+
+        m_UndefinedNames.push_back(ident.GetName());
+    }
+
+    Vector<Scope> m_Scopes;
+    Vector<String> m_UndefinedNames;
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "ASTNode.h"
+#include "ASTNodeDefinitions.h"
+#include "CommonTypes.h"
+#include "JSONSerializerVisitor.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Serializes the statements of a root TopStatements on several threads.
+// Statements are split into chunks; each chunk is written by its own
+// JSONSerializerVisitor into its own buffer, resuming at the indentation and
+// separator the serial walk would have reached. The writer thread gathers
+// finished chunks in order and hands them to writev, so the output is byte
+// for byte what root->Accept(JSONSerializerVisitor{}) prints. At most
+// `window` chunks are buffered at once, which bounds memory on huge dumps.
+class ParallelJSONSerializer {
+public:
+    explicit ParallelJSONSerializer(int fd = STDOUT_FILENO, unsigned threads = 0,
+                                    size_t chunkStatements = 256)
+        : m_Fd(fd), m_Threads(threads), m_ChunkStatements(std::max<size_t>(chunkStatements, 1))
+    {
+        if (m_Threads == 0) {
+            m_Threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_Window = m_Threads * 4;
+    }
+
+    // Returns false if writing failed. Roots other than TopStatements have
+    // nothing to split and are serialized on the calling thread.
+    bool Serialize(const ASTNodeRef& root) {
+        if (!root || root->GetKind() != ASTNodeKind::TopStatements) {
+            std::string text;
+            StringBuffer buffer(text);
+            std::ostream output(&buffer);
+            root->Accept(JSONSerializerVisitor(output));
+            return WriteAll(text);
+        }
+
+        const auto& statements = static_cast<const TopStatements&>(*root).GetStatements();
+        const size_t chunkCount = (statements.size() + m_ChunkStatements - 1) / m_ChunkStatements;
+        m_Chunks = Vector<Chunk>(chunkCount);
+        m_NextChunk = 0;
+        m_WrittenChunks = 0;
+        m_Failed = false;
+
+        std::string header;
+        {
+            StringBuffer buffer(header);
+            std::ostream output(&buffer);
+            JSONSerializerVisitor(output).BeginTopStatements();
+        }
+        bool ok = WriteAll(header);
+
+        Vector<std::thread> workers;
+        const size_t workerCount = std::min<size_t>(m_Threads, chunkCount);
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back([&] { RunWorker(statements); });
+        }
+        ok = WriteChunks() && ok;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        std::string footer;
+        {
+            StringBuffer buffer(footer);
+            std::ostream output(&buffer);
+            JSONSerializerVisitor serializer(output);
+            serializer.ResumeTopStatements((int)statements.size());
+            serializer.EndTopStatements();
+        }
+        return WriteAll(footer) && ok;
+    }
+
+private:
+    // Appends straight into a std::string, so a chunk is never copied
+    // between being formatted and being written
+    class StringBuffer final : public std::streambuf {
+    public:
+        explicit StringBuffer(std::string& text)
+            : m_Text(text)
+        {}
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (c != traits_type::eof()) {
+                m_Text.push_back((char)c);
+            }
+            return c;
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size) override {
+            m_Text.append(data, (size_t)size);
+            return size;
+        }
+
+    private:
+        std::string& m_Text;
+    };
+
+    struct Chunk {
+        std::string text;
+        bool ready = false;
+    };
+
+    void RunWorker(const Vector<ASTNodeRef>& statements) {
+        for (;;) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_CanClaim.wait(lock, [&] {
+                    return m_Failed || m_NextChunk >= m_Chunks.size() || m_NextChunk < m_WrittenChunks + m_Window;
+                });
+                if (m_Failed || m_NextChunk >= m_Chunks.size()) {
+                    return;
+                }
+                index = m_NextChunk++;
+            }
+
+            TRACE_SCOPE("JSONChunk");
+            Chunk& chunk = m_Chunks[index];
+            const size_t begin = index * m_ChunkStatements;
+            const size_t end = std::min(begin + m_ChunkStatements, statements.size());
+            {
+                StringBuffer buffer(chunk.text);
+                std::ostream output(&buffer);
+                JSONSerializerVisitor serializer(output);
+                serializer.ResumeTopStatements((int)begin);
+                for (size_t i = begin; i < end; ++i) {
+                    serializer.SerializeTopStatement(statements[i]);
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                chunk.ready = true;
+            }
+            m_Ready.notify_one();
+        }
+    }
+
+    // Writes chunks in order, batching every run of finished ones into a
+    // single writev
+    bool WriteChunks() {
+        Vector<struct iovec> batch;
+        size_t next = 0;
+        while (next < m_Chunks.size()) {
+            size_t end;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Ready.wait(lock, [&] { return m_Chunks[next].ready; });
+                end = next;
+                while (end < m_Chunks.size() && m_Chunks[end].ready && end - next < IOV_MAX) {
+                    ++end;
+                }
+            }
+
+            batch.clear();
+            for (size_t i = next; i < end; ++i) {
+                batch.push_back(iovec{ m_Chunks[i].text.data(), m_Chunks[i].text.size() });
+            }
+            const bool written = WriteVector(batch);
+            for (size_t i = next; i < end; ++i) {
+                std::string().swap(m_Chunks[i].text);
+            }
+            next = end;
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_WrittenChunks = next;
+                m_Failed = !written;
+            }
+            m_CanClaim.notify_all();
+            if (!written) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // writev may stop short; resume from wherever it did
+    bool WriteVector(Vector<struct iovec>& iov) {
+        size_t first = 0;
+        while (first < iov.size()) {
+            const ssize_t written = writev(m_Fd, iov.data() + first, (int)(iov.size() - first));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+
+            size_t remaining = (size_t)written;
+            while (first < iov.size() && remaining >= iov[first].iov_len) {
+                remaining -= iov[first].iov_len;
+                ++first;
+            }
+            if (remaining > 0) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+                iov[first].iov_len -= remaining;
+            }
+        }
+        return true;
+    }
+
+    bool WriteAll(std::string& text) {
+        Vector<struct iovec> iov{ iovec{ text.data(), text.size() } };
+        return WriteVector(iov);
+    }
+
+    int m_Fd;
+    unsigned m_Threads;
+    size_t m_ChunkStatements;
+    size_t m_Window;
+
+    Vector<Chunk> m_Chunks;
+    std::mutex m_Mutex;
+    std::condition_variable m_CanClaim;
+    std::condition_variable m_Ready;
+    size_t m_NextChunk = 0;
+    size_t m_WrittenChunks = 0;
+    bool m_Failed = false;
+};
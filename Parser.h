@@ -3,16 +3,19 @@
 #include "CommonTypes.h"
 #include "Token.h"
 #include "ASTNode.h"
+#include "Trace.h"
+#include "Utils.h"
+#include "Diagnostics.h"
 
 #include <cassert>
 #include <algorithm>
 
-#define TRY_PARSE(AST_NODE) if (auto node = Parse##AST_NODE()) return node
+#define TRY_PARSE(AST_NODE) if (auto node = TryParse(&Parser::Parse##AST_NODE)) return node
 
 class Parser {
 public:
-    explicit Parser(TokenList tokens)
-        : m_Tokens(std::move(tokens))
+    Parser(TokenList tokens, DiagnosticEngine& diagnostics)
+        : m_Tokens(std::move(tokens)), m_Diagnostics(diagnostics)
     {}
 
     bool Consume(TokenType type) {
@@ -32,14 +35,27 @@ public:
         return m_Tokens[m_Current - 1];
     }
 
+    // Runs one parsing alternative, rewinding on failure so the next
+    // alternative starts from the same token. The furthest token any
+    // alternative reached is where the error gets reported.
+    ASTNodeRef TryParse(ASTNodeRef (Parser::*parse)()) {
+        const int start = m_Current;
+        if (auto node = (this->*parse)()) {
+            return node;
+        }
+        m_Furthest = std::max(m_Furthest, m_Current);
+        m_Current = start;
+        return nullptr;
+    }
+
     ASTNodeRef ParseExpression() {
         if (Consume(TokenType::INT_LITERAL)) {
             int initialValue = std::get<int>(GetPrevToken().data);
-            return MakeShared<IntegerLiteralExpression>(initialValue);
+            return MakeShared<IntegerLiteralExpression>(initialValue, LiteralType{});
 
         } else if (Consume(TokenType::IDENTIFIER)) {
             String initialValue = std::get<String>(GetPrevToken().data);
-            return MakeShared<IdentifierExpression>(initialValue);
+            return MakeShared<IdentifierExpression>(initialValue, NameBinding{});
         }
 
         return nullptr;
@@ -51,36 +67,106 @@ public:
         });
     }
 
-    ASTNodeRef ParseAdditiveExpression() {
-        auto left = ParseMultiplicativeExpression();
-        while (ConsumeOneOf({ TokenType::PLUS, TokenType::MINUS })) {
-            TokenType op = GetPrevToken().type;
-            if (auto right = ParseMultiplicativeExpression()) {
-                left = MakeShared<BinaryExpression>(op, left, right);
-            } else {
-                return nullptr;
-            }
+    static int GetBinaryPrecedence(TokenType type) {
+        switch (type) {
+            case TokenType::LESS:
+            case TokenType::GREATER:
+                return 1;
+            case TokenType::PLUS:
+            case TokenType::MINUS:
+                return 2;
+            case TokenType::STAR:
+            case TokenType::SLASH:
+                return 3;
+            default:
+                return 0;
         }
+    }
+
+    void ReduceBinaryExpression() {
+        ASTNodeRef right = std::move(m_Operands.back());
+        m_Operands.pop_back();
+        ASTNodeRef left = std::move(m_Operands.back());
+        m_Operands.pop_back();
 
-        return left;
+        m_Operands.push_back(MakeShared<BinaryExpression>(m_Operators.back(), left, right));
+        m_Operators.pop_back();
     }
 
-    ASTNodeRef ParseMultiplicativeExpression() {
-        ASTNodeRef left = ParseExpression();
-        while (ConsumeOneOf({ TokenType::STAR, TokenType::SLASH })) {
-            TokenType op = GetPrevToken().type;
-            if (auto right = ParseExpression()) {
-                left = MakeShared<BinaryExpression>(op, left, right);
-            } else {
+    // Operator-precedence parsing over explicit operand/operator stacks
+    // instead of one C++ frame per precedence level and parenthesis, so
+    // nesting depth is bounded by the heap rather than the native stack.
+    // LPAREN entries on the operator stack mark open groups.
+    ASTNodeRef ParseBinaryExpression() {
+        const size_t operandsBase = m_Operands.size();
+        const size_t operatorsBase = m_Operators.size();
+        defer({
+            m_Operands.resize(operandsBase);
+            m_Operators.resize(operatorsBase);
+        });
+
+        int openGroups = 0;
+        while (true) {
+            while (Consume(TokenType::LPAREN)) {
+                m_Operators.push_back(TokenType::LPAREN);
+                ++openGroups;
+            }
+
+            ASTNodeRef operand = ParseExpression();
+            if (!operand) {
                 return nullptr;
             }
+            m_Operands.push_back(std::move(operand));
+
+            while (openGroups > 0 && Consume(TokenType::RPAREN)) {
+                while (m_Operators.back() != TokenType::LPAREN) {
+                    ReduceBinaryExpression();
+                }
+                m_Operators.pop_back();
+                --openGroups;
+            }
+
+            const TokenType op = GetCurrentToken().type;
+            const int precedence = GetBinaryPrecedence(op);
+            if (precedence == 0) {
+                break;
+            }
+            ++m_Current;
+
+            while (m_Operators.size() > operatorsBase &&
+                   m_Operators.back() != TokenType::LPAREN &&
+                   GetBinaryPrecedence(m_Operators.back()) >= precedence) {
+                ReduceBinaryExpression();
+            }
+            m_Operators.push_back(op);
         }
 
-        return left;
+        if (openGroups > 0) {
+            return nullptr;
+        }
+
+        while (m_Operators.size() > operatorsBase) {
+            ReduceBinaryExpression();
+        }
+        return m_Operands.back();
     }
 
     ASTNodeRef ParseAssignmentExpression() {
-        TRY_PARSE(AdditiveExpression);
+        const bool isAssignment = GetCurrentToken().type == TokenType::IDENTIFIER &&
+                                  m_Tokens[m_Current + 1].type == TokenType::EQUALS;
+        if (isAssignment) {
+            Consume(TokenType::IDENTIFIER);
+            String targetName = std::get<String>(GetPrevToken().data);
+            Consume(TokenType::EQUALS);
+
+            if (auto value = ParseBinaryExpression()) {
+                auto target = MakeShared<IdentifierExpression>(targetName, NameBinding{});
+                return MakeShared<AssignmentExpression>(target, value);
+            }
+            return nullptr;
+        }
+
+        TRY_PARSE(BinaryExpression);
         return nullptr;
     }
 
@@ -88,7 +174,7 @@ public:
         if (Consume(TokenType::LET) && Consume(TokenType::IDENTIFIER)) {
             auto identifierName = std::get<String>(GetPrevToken().data);
             if (Consume(TokenType::EQUALS)) {
-                if (auto initialValueExpr = ParseAdditiveExpression()) {
+                if (auto initialValueExpr = ParseBinaryExpression()) {
                     if (Consume(TokenType::SEMI_COLON)) {
                         return MakeShared<VariableDeclaration>(identifierName, initialValueExpr);
                     }
@@ -113,6 +199,69 @@ public:
         return false;
     }
 
+    // Blocks recurse through ParseTopStatements, and so do the visitors that
+    // later walk them, so nesting is capped well below what the native stack
+    // can take. A block past the limit is reported and skipped as empty.
+    static constexpr int MaxBlockDepth = 256;
+
+    ASTNodeRef ParseBlock() {
+        if (Consume(TokenType::LCURLY)) {
+            if (m_BlockDepth >= MaxBlockDepth) {
+                return SkipTooDeepBlock();
+            }
+
+            ++m_BlockDepth;
+            auto statements = ParseTopStatements();
+            --m_BlockDepth;
+
+            if (statements) {
+                if (Consume(TokenType::RCURLY)) {
+                    return statements;
+                }
+            }
+
+        }
+        return nullptr;
+    }
+
+    ASTNodeRef SkipTooDeepBlock() {
+        const Token& open = GetPrevToken();
+        m_Diagnostics.Error(SourceRange{ open.location, open.endLocation },
+                            String("blocks nested more than ") + std::to_string(MaxBlockDepth).c_str() + " deep");
+
+        int depth = 1;
+        while (GetCurrentToken().type != TokenType::END_OF_FILE) {
+            const TokenType type = m_Tokens[m_Current++].type;
+            if (type == TokenType::LCURLY) {
+                ++depth;
+            } else if (type == TokenType::RCURLY && --depth == 0) {
+                return MakeShared<TopStatements>(Vector<ASTNodeRef>{});
+            }
+        }
+        return nullptr;
+    }
+
+    // for (let i = 0; i < n; i = i + 1) { ... }
+    ASTNodeRef ParseForStatement() {
+        if (Consume(TokenType::FOR) && Consume(TokenType::LPAREN)) {
+            if (auto initialization = ParseVariableDeclaration()) {
+                if (auto condition = ParseBinaryExpression()) {
+                    if (Consume(TokenType::SEMI_COLON)) {
+                        if (auto increment = ParseAssignmentExpression()) {
+                            if (Consume(TokenType::RPAREN)) {
+                                if (auto body = ParseBlock()) {
+                                    return MakeShared<ForStatement>(initialization, condition, increment, body);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
     ASTNodeRef ParseFunctionDeclaration() {
         auto ParseParameterList = [&](Vector<FuncParam>& params) -> bool {
             if (Consume(TokenType::LPAREN)) {
@@ -129,28 +278,19 @@ public:
             return false;
         };
 
-        auto ParseBody = [&]() -> ASTNodeRef {
-            if (Consume(TokenType::LCURLY)) {
-                if (auto statements = ParseTopStatements()) {
-                    if (Consume(TokenType::RCURLY)) {
-                        return statements;
-                    }
-                }
-
-            }
-            return nullptr;
-        };
-
         if (Consume(TokenType::FUNCTION) && Consume(TokenType::IDENTIFIER)) {
             String functionIdent = std::get<String>(GetPrevToken().data);
+            const Location nameLocation = GetPrevToken().location;
 
             Vector<FuncParam> params;
             if (ParseParameterList(params)) {
                 if (Consume(TokenType::ARROW) && Consume(TokenType::IDENTIFIER)) {
                     String returnType = std::get<String>(GetPrevToken().data);
 
-                    if (auto body = ParseBody()) {
-                        return MakeShared<FunctionDeclaration>(functionIdent, params, returnType, body);
+                    if (auto body = ParseBlock()) {
+                        auto decl = MakeShared<FunctionDeclaration>(functionIdent, params, returnType, body);
+                        decl->SetLocation(nameLocation);
+                        return decl;
                     }
                 }
             }
@@ -162,36 +302,89 @@ public:
     ASTNodeRef ParseTopStatement() {
         TRY_PARSE(FunctionDeclaration);
         TRY_PARSE(VariableDeclaration);
+        TRY_PARSE(ForStatement);
         return nullptr;
     }
 
+    bool IsAtBlockEnd() const {
+        const TokenType type = GetCurrentToken().type;
+        return type == TokenType::END_OF_FILE || (type == TokenType::RCURLY && m_BlockDepth > 0);
+    }
+
+    // Skips to just past the next ';' or balanced '{...}' block, or up to
+    // the '}' closing the enclosing block, whichever comes first
+    void Synchronize() {
+        int depth = 0;
+        while (GetCurrentToken().type != TokenType::END_OF_FILE) {
+            const TokenType type = GetCurrentToken().type;
+            if (type == TokenType::RCURLY && depth == 0 && m_BlockDepth > 0) {
+                return;
+            }
+
+            ++m_Current;
+            if (type == TokenType::LCURLY) {
+                ++depth;
+            } else if (type == TokenType::RCURLY) {
+                if (depth <= 1) return;
+                --depth;
+            } else if (type == TokenType::SEMI_COLON && depth == 0) {
+                return;
+            }
+        }
+    }
+
+    void ReportUnexpectedToken() {
+        const Token& token = GetCurrentToken();
+        m_Diagnostics.Error(SourceRange{ token.location, token.endLocation },
+                            String("unexpected token ") + GetTokenName(token.type));
+    }
+
     ASTNodeRef ParseTopStatements() {
         Vector<ASTNodeRef> statements;
-        while (auto statement = ParseTopStatement()) {
-            statements.push_back(std::move(statement));
+        while (!IsAtBlockEnd()) {
+            m_Furthest = m_Current;
+            if (auto statement = ParseTopStatement()) {
+                statements.push_back(std::move(statement));
+                continue;
+            }
+
+            m_Current = std::max(m_Furthest, m_Current);
+            ReportUnexpectedToken();
+            Synchronize();
         }
         return MakeShared<TopStatements>(statements);
     }
 
-    static ASTNodeRef Parse(const TokenList& tokens) {
-        Parser parser(tokens);
-        auto statements = parser.ParseTopStatements();
+    static ASTNodeRef Parse(const TokenList& tokens, DiagnosticEngine& diagnostics) {
+        TRACE_SCOPE("Parse");
+        MEM_STATS_PHASE("Parse");
 
-        const Token& currentToken = parser.GetCurrentToken();
-        if (currentToken.type != TokenType::END_OF_FILE) {
-            std::cout << "Unexpected token: " << GetTokenName(currentToken.type);
-            std::cout << " (" << currentToken.location.line << ":" << currentToken.location.column << ")";
-            std::cout << std::endl;
-        }
+        Parser parser(tokens, diagnostics);
+        return parser.ParseTopStatements();
+    }
+
+    static ASTNodeRef Parse(const TokenList& tokens) {
+        DiagnosticEngine diagnostics;
+        auto statements = Parse(tokens, diagnostics);
+        diagnostics.Dump(std::cerr);
         return statements;
     }
 
 private:
     TokenList m_Tokens;
+    DiagnosticEngine& m_Diagnostics;
     int m_Current = 0;
+    int m_Furthest = 0;
+    int m_BlockDepth = 0;
+    Vector<ASTNodeRef> m_Operands;
+    Vector<TokenType> m_Operators;
 };
 
-static ASTNodeRef Parse(const TokenList& tokens) {
+inline ASTNodeRef Parse(const TokenList& tokens) {
     return Parser::Parse(tokens);
 }
 
+inline ASTNodeRef Parse(const TokenList& tokens, DiagnosticEngine& diagnostics) {
+    return Parser::Parse(tokens, diagnostics);
+}
+
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Diagnostics.h"
+#include "FunctionDeclCollector.h"
+#include "JSONSerializerVisitor.h"
+#include "Lexer.h"
+#include "NameResolver.h"
+#include "Parser.h"
+#include "SpscRing.h"
+#include "Trace.h"
+#include "TypeChecker.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+// Runs lexing, parsing and the backend (name resolution, function
+// collection, type checking and JSON output) on three threads connected by SPSC rings:
+//
+//   lexer --token batches--> parser --top-level statements--> backend
+//
+// The parser cuts the token stream after each complete top-level statement
+// (a ';' or closing '}' outside any brackets) and parses it on its own, so
+// the backend can start on a statement while later ones are still being
+// lexed. Output is the same as running the stages one after another; only
+// error recovery can differ, since a statement never spans two cuts.
+class PipelinedFrontEnd {
+public:
+    struct StageStats {
+        const char* name = "";
+        uint64_t items = 0;
+        StallTime inputStall;   // waiting on an empty input ring
+        StallTime outputStall;  // waiting on a full output ring
+        double totalMilliseconds = 0;
+    };
+
+    explicit PipelinedFrontEnd(std::ostream& output = std::cout, size_t batchSize = 1024)
+        : m_Output(output), m_BatchSize(batchSize)
+    {}
+
+    // Returns false if the input couldn't be lexed at all
+    bool Run(Lexer& lexer) {
+        m_Stats[0].name = "Lexer";
+        m_Stats[1].name = "Parser";
+        m_Stats[2].name = "Backend";
+
+        std::thread lexerThread([&] { Timed(m_Stats[0], [&] { RunLexer(lexer); }); });
+        std::thread parserThread([&] { Timed(m_Stats[1], [&] { RunParser(); }); });
+        Timed(m_Stats[2], [&] { RunBackend(lexer.GetFilename()); });
+        lexerThread.join();
+        parserThread.join();
+        return m_LexerOk;
+    }
+
+    void DumpDiagnostics(std::ostream& out, const char* filename) const {
+        m_LexerDiagnostics.Dump(out, filename);
+        m_ParserDiagnostics.Dump(out, filename);
+        if (m_Collector) {
+            m_Collector->DumpDuplicates(out);
+        }
+        m_NameResolver.DumpErrors(out);
+        m_TypeChecker.DumpErrors(out);
+    }
+
+    void DumpStats(std::ostream& out = std::cerr) const {
+        out << std::left << std::setw(10) << "Stage" << std::right << std::setw(10) << "items"
+            << std::setw(16) << "input stall ms" << std::setw(17) << "output stall ms" << std::setw(12) << "total ms\n";
+        for (const StageStats& stage : m_Stats) {
+            out << std::left << std::setw(10) << stage.name << std::right << std::setw(10) << stage.items
+                << std::fixed << std::setprecision(2) << std::setw(16) << stage.inputStall.GetMilliseconds()
+                << std::setw(17) << stage.outputStall.GetMilliseconds() << std::setw(11) << stage.totalMilliseconds
+                << '\n';
+        }
+        out.unsetf(std::ios::floatfield);
+    }
+
+private:
+    template <typename Func>
+    static void Timed(StageStats& stats, Func&& func) {
+        TRACE_SCOPE(stats.name);
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        stats.totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void RunLexer(Lexer& lexer) {
+        StageStats& stats = m_Stats[0];
+        m_LexerOk = lexer.HasStream() && ValidateEncoding(lexer, m_LexerDiagnostics);
+
+        TokenList batch;
+        batch.reserve(m_BatchSize);
+        Token token;
+        while (m_LexerOk && LexNextToken(lexer, token, m_LexerDiagnostics)) {
+            ++stats.items;
+            batch.push_back(std::move(token));
+            if (batch.size() == m_BatchSize) {
+                m_Tokens.Push(std::move(batch), stats.outputStall);
+                batch = TokenList();
+                batch.reserve(m_BatchSize);
+            }
+        }
+        if (!batch.empty()) {
+            m_Tokens.Push(std::move(batch), stats.outputStall);
+        }
+        m_Tokens.Close();
+    }
+
+    void RunParser() {
+        StageStats& stats = m_Stats[1];
+        TokenList pending;
+        size_t statementBegin = 0;
+        size_t scanned = 0;
+        int bracketDepth = 0;
+
+        TokenList batch;
+        while (m_Tokens.Pop(batch, stats.inputStall)) {
+            for (auto& token : batch) {
+                pending.push_back(std::move(token));
+            }
+
+            for (; scanned < pending.size(); ++scanned) {
+                const TokenType type = pending[scanned].type;
+                const bool statementEnd = (type == TokenType::SEMI_COLON && bracketDepth == 0) ||
+                                          (type == TokenType::RCURLY && bracketDepth <= 1);
+                if (type == TokenType::LCURLY || type == TokenType::LPAREN) {
+                    ++bracketDepth;
+                } else if ((type == TokenType::RCURLY || type == TokenType::RPAREN) && bracketDepth > 0) {
+                    --bracketDepth;
+                }
+
+                if (statementEnd) {
+                    ParseStatements(pending, statementBegin, scanned + 1, stats);
+                    statementBegin = scanned + 1;
+                    bracketDepth = 0;
+                }
+            }
+
+            // Drop consumed tokens once they are the bulk of the buffer
+            if (statementBegin > 0 && statementBegin * 2 >= pending.size()) {
+                pending.erase(pending.begin(), pending.begin() + statementBegin);
+                scanned -= statementBegin;
+                statementBegin = 0;
+            }
+        }
+
+        // Whatever is left ends with the END_OF_FILE token
+        ParseStatements(pending, statementBegin, pending.size(), stats);
+        m_Statements.Close();
+    }
+
+    void ParseStatements(TokenList& pending, size_t begin, size_t end, StageStats& stats) {
+        if (begin == end) {
+            return;
+        }
+
+        TokenList chunk(std::make_move_iterator(pending.begin() + begin), std::make_move_iterator(pending.begin() + end));
+        if (chunk.back().type != TokenType::END_OF_FILE) {
+            Token eof = CreateToken<TokenType::END_OF_FILE>(chunk.back().endLocation);
+            eof.endLocation = eof.location;
+            chunk.push_back(std::move(eof));
+        }
+
+        Parser parser(std::move(chunk), m_ParserDiagnostics);
+        ASTNodeRef block = parser.ParseTopStatements();
+        for (auto& statement : static_cast<TopStatements&>(*block).GetStatements()) {
+            ++stats.items;
+            m_Statements.Push(std::move(statement), stats.outputStall);
+        }
+    }
+
+    void RunBackend(const char* filename) {
+        StageStats& stats = m_Stats[2];
+        m_Collector.emplace(m_Functions, filename);
+        JSONSerializerVisitor serializer(m_Output);
+
+        m_NameResolver.BeginTopLevel();
+        m_TypeChecker.BeginTopLevel();
+        serializer.BeginTopStatements();
+        ASTNodeRef statement;
+        while (m_Statements.Pop(statement, stats.inputStall)) {
+            ++stats.items;
+            m_NameResolver.ResolveTopLevelStatement(statement);
+            statement->Accept(*m_Collector);
+            m_TypeChecker.CheckTopLevelStatement(statement);
+            serializer.SerializeTopStatement(statement);
+            // Collected declarations point into the statements
+            m_Program.push_back(std::move(statement));
+        }
+        serializer.EndTopStatements();
+        m_TypeChecker.EndTopLevel();
+        m_NameResolver.EndTopLevel();
+    }
+
+    std::ostream& m_Output;
+    size_t m_BatchSize;
+
+    SpscRing<TokenList> m_Tokens{ 64 };
+    SpscRing<ASTNodeRef> m_Statements{ 1024 };
+    StageStats m_Stats[3];
+
+    bool m_LexerOk = false;
+    DiagnosticEngine m_LexerDiagnostics;
+    DiagnosticEngine m_ParserDiagnostics;
+    NameResolver m_NameResolver;
+    TypeTable m_Types;
+    TypeChecker m_TypeChecker{ m_Types };
+    FunctionSymbolTable m_Functions;
+    std::optional<FunctionDeclCollector> m_Collector;
+    Vector<ASTNodeRef> m_Program;
+};
@@ -0,0 +1,500 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "FunctionDeclCollector.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Relocatable image of an analyzed program: the AST with its name bindings
+// and the function table, laid out with offsets instead of pointers so a
+// snapshot file can be mmapped and used as is. All sections are arrays of
+// 32-bit words in host byte order:
+//
+//   SnapshotHeader
+//   SnapshotNode[nodeCount]         kind and where its properties start
+//   uint32_t[fieldCount]            properties of all nodes, see below
+//   SnapshotFunction[functionCount] sorted by name for binary search
+//   char[stringsSize]               NUL-terminated strings, deduplicated
+//
+// Nodes are numbered breadth first, so children always come after their
+// parent. Properties are written in *_PROPERTIES order: int and TokenType
+// take one word, String two (offset, length), ASTNodeRef the node index,
+// NameBinding three, LiteralType like its String name, and vectors a count
+// followed by their elements.
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t size;
+    uint32_t nodeCount;
+    uint32_t nodesOffset;
+    uint32_t fieldCount;
+    uint32_t fieldsOffset;
+    uint32_t functionCount;
+    uint32_t functionsOffset;
+    uint32_t stringsSize;
+    uint32_t stringsOffset;
+    uint32_t reserved;
+};
+
+struct SnapshotNode {
+    uint32_t kind;
+    uint32_t firstField;
+};
+
+struct SnapshotFunction {
+    uint32_t name;
+    uint32_t nameLength;
+    uint32_t returnType;
+    uint32_t returnTypeLength;
+    uint32_t node;
+    uint32_t parameterCount;
+    // Field index of the first (name, length, type, length) parameter
+    uint32_t firstParameter;
+    uint32_t reserved;
+};
+
+inline constexpr char SnapshotMagic[8] = { 'Z', 'I', 'X', 'S', 'N', 'A', 'P', '\0' };
+inline constexpr uint32_t SnapshotVersion = 2;
+inline constexpr uint32_t SnapshotByteOrder = 0x01020304;
+inline constexpr uint32_t NoSnapshotNode = UINT32_MAX;
+
+#define COUNT_AST_NODE_KINDS(NAME, PROPERTIES) + 1
+inline constexpr uint32_t SnapshotNodeKindCount = 0 AST_NODES_LIST(COUNT_AST_NODE_KINDS);
+#undef COUNT_AST_NODE_KINDS
+
+#define WRITE_SNAPSHOT_PROPERTY(TYPE, NAME) WriteProperty(node.Get##NAME());
+
+#define WRITE_SNAPSHOT_NODE(NAME, PROPERTIES)                   \
+    case ASTNodeKind::NAME: {                                   \
+        const auto& node = static_cast<const NAME&>(*current);  \
+        PROPERTIES(WRITE_SNAPSHOT_PROPERTY)                     \
+        break;                                                  \
+    }
+
+class SnapshotWriter {
+public:
+    Vector<unsigned char> Write(const ASTNodeRef& root, const FunctionSymbolTable& functions) {
+        TRACE_SCOPE("SnapshotWriter");
+
+        WriteNodes(root);
+        WriteFunctions(functions);
+
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+        header.version = SnapshotVersion;
+        header.byteOrder = SnapshotByteOrder;
+        header.nodeCount = (uint32_t)m_Nodes.size();
+        header.fieldCount = (uint32_t)m_Fields.size();
+        header.functionCount = (uint32_t)m_Functions.size();
+        header.stringsSize = (uint32_t)m_Strings.size();
+
+        // Every section size is a multiple of 4, so offsets stay aligned
+        // once the string pool is padded
+        while (m_Strings.size() % 4 != 0) {
+            m_Strings.push_back('\0');
+        }
+
+        Vector<unsigned char> blob;
+        blob.reserve(sizeof(header) + m_Nodes.size() * sizeof(SnapshotNode) + m_Fields.size() * sizeof(uint32_t) +
+                     m_Functions.size() * sizeof(SnapshotFunction) + m_Strings.size());
+        auto Append = [&](const void* data, size_t size) {
+            const size_t offset = blob.size();
+            blob.resize(offset + size);
+            if (size > 0) {
+                std::memcpy(blob.data() + offset, data, size);
+            }
+            return (uint32_t)offset;
+        };
+
+        Append(&header, sizeof(header));
+        header.nodesOffset = Append(m_Nodes.data(), m_Nodes.size() * sizeof(SnapshotNode));
+        header.fieldsOffset = Append(m_Fields.data(), m_Fields.size() * sizeof(uint32_t));
+        header.functionsOffset = Append(m_Functions.data(), m_Functions.size() * sizeof(SnapshotFunction));
+        header.stringsOffset = Append(m_Strings.data(), m_Strings.size());
+        header.size = (uint32_t)blob.size();
+        std::memcpy(blob.data(), &header, sizeof(header));
+        return blob;
+    }
+
+private:
+    // Breadth first with an explicit queue, so deep trees don't recurse
+    void WriteNodes(const ASTNodeRef& root) {
+        Enqueue(root);
+        for (size_t index = 0; index < m_Queue.size(); ++index) {
+            const ASTNode* current = m_Queue[index];
+            m_Current = (uint32_t)index;
+            m_Nodes.push_back(SnapshotNode{ (uint32_t)current->GetKind(), (uint32_t)m_Fields.size() });
+            switch (current->GetKind()) {
+                AST_NODES_LIST(WRITE_SNAPSHOT_NODE)
+            }
+        }
+    }
+
+    void WriteFunctions(const FunctionSymbolTable& functions) {
+        functions.ForEach([&](const String& name, const FunctionDeclMetaData& meta) {
+            auto node = m_NodeIndices.find(meta.declaration);
+            if (node == m_NodeIndices.end()) {
+                return;
+            }
+
+            SnapshotFunction function = {};
+            function.name = InternString(name);
+            function.nameLength = (uint32_t)name.size();
+            function.returnType = InternString(meta.GetReturnType());
+            function.returnTypeLength = (uint32_t)meta.GetReturnType().size();
+            function.node = node->second;
+            function.parameterCount = (uint32_t)meta.GetParameters().size();
+            function.firstParameter = m_ParameterFields[node->second];
+            m_Functions.push_back(function);
+        });
+
+        std::sort(m_Functions.begin(), m_Functions.end(), [this](const SnapshotFunction& a, const SnapshotFunction& b) {
+            return GetString(a.name, a.nameLength) < GetString(b.name, b.nameLength);
+        });
+    }
+
+    uint32_t Enqueue(const ASTNodeRef& node) {
+        if (!node) {
+            return NoSnapshotNode;
+        }
+        const uint32_t index = (uint32_t)m_Queue.size();
+        m_Queue.push_back(node.get());
+        if (node->GetKind() == ASTNodeKind::FunctionDeclaration) {
+            m_NodeIndices.emplace(node.get(), index);
+        }
+        return index;
+    }
+
+    uint32_t InternString(const String& value) {
+        auto [it, inserted] = m_StringOffsets.try_emplace(value, (uint32_t)m_Strings.size());
+        if (inserted) {
+            m_Strings.insert(m_Strings.end(), value.begin(), value.end());
+            m_Strings.push_back('\0');
+        }
+        return it->second;
+    }
+
+    std::string_view GetString(uint32_t offset, uint32_t length) const {
+        return std::string_view(m_Strings.data() + offset, length);
+    }
+
+    void WriteProperty(int value) {
+        m_Fields.push_back((uint32_t)value);
+    }
+
+    void WriteProperty(TokenType value) {
+        m_Fields.push_back((uint32_t)value);
+    }
+
+    void WriteProperty(const String& value) {
+        m_Fields.push_back(InternString(value));
+        m_Fields.push_back((uint32_t)value.size());
+    }
+
+    void WriteProperty(const ASTNodeRef& child) {
+        m_Fields.push_back(Enqueue(child));
+    }
+
+    void WriteProperty(const NameBinding& binding) {
+        m_Fields.push_back((uint32_t)binding.kind);
+        m_Fields.push_back((uint32_t)binding.depth);
+        m_Fields.push_back((uint32_t)binding.slot);
+    }
+
+    void WriteProperty(const LiteralType& type) {
+        WriteProperty(type.name);
+    }
+
+    void WriteProperty(const Vector<ASTNodeRef>& children) {
+        m_Fields.push_back((uint32_t)children.size());
+        for (const auto& child : children) {
+            WriteProperty(child);
+        }
+    }
+
+    void WriteProperty(const Vector<FuncParam>& parameters) {
+        m_Fields.push_back((uint32_t)parameters.size());
+        m_ParameterFields[m_Current] = (uint32_t)m_Fields.size();
+        for (const auto& parameter : parameters) {
+            WriteProperty(parameter.name);
+            WriteProperty(parameter.type);
+        }
+    }
+
+    Vector<const ASTNode*> m_Queue;
+    // Only function declarations, which the function table refers to
+    HashMap<const ASTNode*, uint32_t> m_NodeIndices;
+    HashMap<uint32_t, uint32_t> m_ParameterFields;
+    uint32_t m_Current = 0;
+
+    Vector<SnapshotNode> m_Nodes;
+    Vector<uint32_t> m_Fields;
+    Vector<SnapshotFunction> m_Functions;
+    Vector<char> m_Strings;
+    HashMap<String, uint32_t> m_StringOffsets;
+};
+
+#undef WRITE_SNAPSHOT_NODE
+#undef WRITE_SNAPSHOT_PROPERTY
+
+#define READ_SNAPSHOT_PROPERTY(TYPE, NAME) \
+    TYPE NAME{};                           \
+    if (!ReadProperty(NAME)) return false;
+
+#define PASS_SNAPSHOT_PROPERTY(TYPE, NAME) NAME,
+
+#define BUILD_SNAPSHOT_NODE(NAME, PROPERTIES)                                       \
+    case ASTNodeKind::NAME: {                                                       \
+        PROPERTIES(READ_SNAPSHOT_PROPERTY)                                          \
+        m_Built[m_Current] = MakeShared<NAME>(PROPERTIES(PASS_SNAPSHOT_PROPERTY) false); \
+        return true;                                                                \
+    }
+
+// Read-only view of a snapshot in memory (usually a mapping). Open() only
+// checks the header and section bounds, so opening doesn't touch the rest
+// of the file; entries are validated as they are read.
+class ProgramSnapshot {
+public:
+    bool Open(const void* data, size_t size, String& error) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        if (size < sizeof(SnapshotHeader) || (uintptr_t)bytes % alignof(SnapshotHeader) != 0) {
+            error = "snapshot is truncated or misaligned";
+            return false;
+        }
+
+        const SnapshotHeader& header = *(const SnapshotHeader*)bytes;
+        if (std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) != 0) {
+            error = "not a zix snapshot";
+            return false;
+        }
+        if (header.version != SnapshotVersion || header.byteOrder != SnapshotByteOrder) {
+            error = "snapshot was written by an incompatible version or byte order";
+            return false;
+        }
+        if (header.size != size ||
+            !IsSection(header.nodesOffset, header.nodeCount, sizeof(SnapshotNode), size) ||
+            !IsSection(header.fieldsOffset, header.fieldCount, sizeof(uint32_t), size) ||
+            !IsSection(header.functionsOffset, header.functionCount, sizeof(SnapshotFunction), size) ||
+            !IsSection(header.stringsOffset, header.stringsSize, 1, size)) {
+            error = "snapshot sections are out of bounds";
+            return false;
+        }
+
+        m_Header = &header;
+        m_Nodes = (const SnapshotNode*)(bytes + header.nodesOffset);
+        m_Fields = (const uint32_t*)(bytes + header.fieldsOffset);
+        m_Functions = (const SnapshotFunction*)(bytes + header.functionsOffset);
+        m_Strings = (const char*)(bytes + header.stringsOffset);
+        return true;
+    }
+
+    uint32_t GetFunctionCount() const {
+        return m_Header->functionCount;
+    }
+
+    // nullptr if index is out of range or the entry is corrupt
+    const SnapshotFunction* GetFunction(uint32_t index) const {
+        if (index >= m_Header->functionCount || !IsValidFunction(m_Functions[index])) {
+            return nullptr;
+        }
+        return &m_Functions[index];
+    }
+
+    // Binary search that only validates the entries it probes
+    const SnapshotFunction* FindFunction(std::string_view name, uint32_t* index = nullptr) const {
+        uint32_t low = 0, high = m_Header->functionCount;
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            if (!IsValidFunction(m_Functions[mid])) {
+                return nullptr;
+            }
+            const std::string_view probe = GetFunctionName(m_Functions[mid]);
+            if (probe < name) {
+                low = mid + 1;
+            } else if (name < probe) {
+                high = mid;
+            } else {
+                if (index) *index = mid;
+                return &m_Functions[mid];
+            }
+        }
+        return nullptr;
+    }
+
+    std::string_view GetFunctionName(const SnapshotFunction& function) const {
+        return std::string_view(m_Strings + function.name, function.nameLength);
+    }
+
+    // Parameter strings aren't covered by Open(), so they are checked here;
+    // false if they are out of bounds
+    bool GetParameter(const SnapshotFunction& function, uint32_t index,
+                      std::string_view& name, std::string_view& type) const {
+        if (index >= function.parameterCount) {
+            return false;
+        }
+        const uint32_t* fields = m_Fields + function.firstParameter + 4 * index;
+        if (!IsString(fields[0], fields[1]) || !IsString(fields[2], fields[3])) {
+            return false;
+        }
+        name = std::string_view(m_Strings + fields[0], fields[1]);
+        type = std::string_view(m_Strings + fields[2], fields[3]);
+        return true;
+    }
+
+    // The string at offset is followed by its NUL, so data() is a C string
+    const char* GetCString(uint32_t offset) const {
+        return m_Strings + offset;
+    }
+
+    // Rebuilds the AST bottom-up, without recursion. Returns nullptr if the
+    // properties are corrupt.
+    ASTNodeRef BuildAST() {
+        TRACE_SCOPE("ProgramSnapshot::BuildAST");
+        const uint32_t nodeCount = m_Header->nodeCount;
+        if (nodeCount == 0) {
+            return nullptr;
+        }
+
+        m_Built.assign(nodeCount, nullptr);
+        for (uint32_t i = nodeCount; i-- > 0;) {
+            m_Current = i;
+            m_Field = m_Nodes[i].firstField;
+
+            if (!BuildNode()) {
+                m_Built.clear();
+                return nullptr;
+            }
+        }
+
+        ASTNodeRef root = std::move(m_Built[0]);
+        m_Built.clear();
+        return root;
+    }
+
+private:
+    static bool IsSection(uint32_t offset, uint32_t count, size_t elementSize, size_t size) {
+        return offset % 4 == 0 && offset <= size && (uint64_t)count * elementSize <= size - offset;
+    }
+
+    bool IsString(uint32_t offset, uint32_t length) const {
+        return offset < m_Header->stringsSize && length < m_Header->stringsSize - offset &&
+               m_Strings[offset + length] == '\0';
+    }
+
+    bool IsValidFunction(const SnapshotFunction& function) const {
+        const uint32_t fieldCount = m_Header->fieldCount;
+        return IsString(function.name, function.nameLength) &&
+               IsString(function.returnType, function.returnTypeLength) && function.node < m_Header->nodeCount &&
+               function.firstParameter <= fieldCount &&
+               function.parameterCount <= (fieldCount - function.firstParameter) / 4;
+    }
+
+    bool BuildNode() {
+        const SnapshotNode& node = m_Nodes[m_Current];
+        if (node.kind >= SnapshotNodeKindCount || node.firstField > m_Header->fieldCount) {
+            return false;
+        }
+        switch ((ASTNodeKind)node.kind) {
+            AST_NODES_LIST(BUILD_SNAPSHOT_NODE)
+        }
+        return false;
+    }
+
+    bool ReadWord(uint32_t& word) {
+        if (m_Field >= m_Header->fieldCount) {
+            return false;
+        }
+        word = m_Fields[m_Field++];
+        return true;
+    }
+
+    bool ReadProperty(int& value) {
+        uint32_t word;
+        if (!ReadWord(word)) return false;
+        value = (int)word;
+        return true;
+    }
+
+    bool ReadProperty(TokenType& value) {
+        uint32_t word;
+        if (!ReadWord(word) || word > (uint32_t)TokenType::END_OF_FILE) return false;
+        value = (TokenType)word;
+        return true;
+    }
+
+    bool ReadProperty(String& value) {
+        uint32_t offset, length;
+        if (!ReadWord(offset) || !ReadWord(length) || !IsString(offset, length)) return false;
+        value.assign(m_Strings + offset, length);
+        return true;
+    }
+
+    // Children must come later in breadth-first order, which also rules
+    // out cycles
+    bool ReadProperty(ASTNodeRef& child) {
+        uint32_t index;
+        if (!ReadWord(index)) return false;
+        if (index == NoSnapshotNode) {
+            child = nullptr;
+            return true;
+        }
+        if (index <= m_Current || index >= m_Header->nodeCount || !m_Built[index]) return false;
+        child = std::move(m_Built[index]);
+        return true;
+    }
+
+    bool ReadProperty(NameBinding& binding) {
+        uint32_t kind, depth, slot;
+        if (!ReadWord(kind) || !ReadWord(depth) || !ReadWord(slot) ||
+            kind > (uint32_t)NameBinding::Kind::Parameter) {
+            return false;
+        }
+        binding = NameBinding{ (NameBinding::Kind)kind, (int)depth, (int)slot };
+        return true;
+    }
+
+    bool ReadProperty(LiteralType& type) {
+        return ReadProperty(type.name);
+    }
+
+    bool ReadProperty(Vector<ASTNodeRef>& children) {
+        uint32_t count;
+        if (!ReadWord(count) || count > m_Header->fieldCount - m_Field) return false;
+        children.resize(count);
+        for (auto& child : children) {
+            if (!ReadProperty(child)) return false;
+        }
+        return true;
+    }
+
+    bool ReadProperty(Vector<FuncParam>& parameters) {
+        uint32_t count;
+        if (!ReadWord(count) || count > (m_Header->fieldCount - m_Field) / 4) return false;
+        parameters.resize(count);
+        for (auto& parameter : parameters) {
+            if (!ReadProperty(parameter.name) || !ReadProperty(parameter.type)) return false;
+        }
+        return true;
+    }
+
+    const SnapshotHeader* m_Header = nullptr;
+    const SnapshotNode* m_Nodes = nullptr;
+    const uint32_t* m_Fields = nullptr;
+    const SnapshotFunction* m_Functions = nullptr;
+    const char* m_Strings = nullptr;
+
+    Vector<ASTNodeRef> m_Built;
+    uint32_t m_Current = 0;
+    uint32_t m_Field = 0;
+};
+
+#undef BUILD_SNAPSHOT_NODE
+#undef PASS_SNAPSHOT_PROPERTY
+#undef READ_SNAPSHOT_PROPERTY
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "CommonTypes.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+
+// Demand-driven, memoized computation with recorded dependencies, in the
+// style of rustc's query system and salsa. Every memo remembers the queries
+// it read while executing, the revision it was last verified in and the
+// revision its value last changed in. Setting an input starts a new
+// revision; a later Get() re-executes a query only if one of its
+// dependencies (checked recursively, inputs first) changed after the memo
+// was verified. Tables created with Backdate compare a recomputed value
+// with the old one and keep the old change revision when they are equal, so
+// an edit that doesn't alter a result stops invalidating at that query.
+
+using Revision = uint64_t;
+
+class QueryTableBase;
+
+struct QueryDependency {
+    QueryTableBase* table;
+    uint32_t slot;
+};
+
+class QueryEngine {
+public:
+    Revision GetRevision() const {
+        return m_Revision;
+    }
+
+    Revision NewRevision() {
+        return ++m_Revision;
+    }
+
+    void PushFrame() {
+        m_Frames.emplace_back();
+    }
+
+    Vector<QueryDependency> PopFrame() {
+        Vector<QueryDependency> dependencies = std::move(m_Frames.back());
+        m_Frames.pop_back();
+        return dependencies;
+    }
+
+    void RecordRead(QueryTableBase* table, uint32_t slot) {
+        if (!m_Frames.empty()) {
+            m_Frames.back().push_back(QueryDependency{ table, slot });
+        }
+    }
+
+private:
+    Revision m_Revision = 1;
+    Vector<Vector<QueryDependency>> m_Frames;
+};
+
+class QueryTableBase {
+public:
+    QueryTableBase(QueryEngine& engine, const char* name)
+        : m_Engine(engine), m_Name(name)
+    {}
+
+    virtual ~QueryTableBase() = default;
+
+    // Brings the memo in slot up to date and reports whether its value
+    // changed after the given revision
+    virtual bool MaybeChangedAfter(uint32_t slot, Revision since) = 0;
+
+    const char* GetName() const {
+        return m_Name;
+    }
+
+    int GetExecutionCount() const {
+        return m_Executions;
+    }
+
+protected:
+    QueryEngine& m_Engine;
+    const char* m_Name;
+    int m_Executions = 0;
+};
+
+// Values set from outside, e.g. the text of a file
+template <typename Key, typename Value>
+class InputTable final : public QueryTableBase {
+public:
+    using QueryTableBase::QueryTableBase;
+
+    void Set(const Key& key, Value value) {
+        const Revision revision = m_Engine.NewRevision();
+        Input& input = GetInput(key);
+        input.value = MakeShared<const Value>(std::move(value));
+        input.changedAt = revision;
+        ++m_Executions;
+    }
+
+    // nullptr if the input was never set
+    SharedPtr<const Value> Get(const Key& key) {
+        const uint32_t slot = GetSlot(key);
+        m_Engine.RecordRead(this, slot);
+        return m_Inputs[slot].value;
+    }
+
+    bool MaybeChangedAfter(uint32_t slot, Revision since) override {
+        return m_Inputs[slot].changedAt > since;
+    }
+
+private:
+    struct Input {
+        SharedPtr<const Value> value;
+        Revision changedAt = 0;
+    };
+
+    uint32_t GetSlot(const Key& key) {
+        auto [it, inserted] = m_Slots.try_emplace(key, (uint32_t)m_Inputs.size());
+        if (inserted) {
+            m_Inputs.emplace_back();
+        }
+        return it->second;
+    }
+
+    Input& GetInput(const Key& key) {
+        return m_Inputs[GetSlot(key)];
+    }
+
+    HashMap<Key, uint32_t> m_Slots;
+    std::deque<Input> m_Inputs;
+};
+
+template <typename Key, typename Value, bool Backdate = false>
+class QueryTable final : public QueryTableBase {
+public:
+    using Compute = std::function<Value(const Key&)>;
+
+    QueryTable(QueryEngine& engine, const char* name, Compute compute)
+        : QueryTableBase(engine, name), m_Compute(std::move(compute))
+    {}
+
+    SharedPtr<const Value> Get(const Key& key) {
+        const uint32_t slot = GetSlot(key);
+        Refresh(slot);
+        m_Engine.RecordRead(this, slot);
+        return m_Memos[slot].value;
+    }
+
+    // Revision at which the value last changed, refreshing it first
+    Revision GetChangedAt(const Key& key) {
+        const uint32_t slot = GetSlot(key);
+        Refresh(slot);
+        return m_Memos[slot].changedAt;
+    }
+
+    bool MaybeChangedAfter(uint32_t slot, Revision since) override {
+        Refresh(slot);
+        return m_Memos[slot].changedAt > since;
+    }
+
+private:
+    // Memos live in a deque so references survive queries that add memos
+    // to the same table while executing
+    struct Memo {
+        explicit Memo(const Key& key)
+            : key(key)
+        {}
+
+        Key key;
+        SharedPtr<const Value> value;
+        Vector<QueryDependency> dependencies;
+        Revision verifiedAt = 0;
+        Revision changedAt = 0;
+        bool executing = false;
+    };
+
+    uint32_t GetSlot(const Key& key) {
+        auto [it, inserted] = m_Slots.try_emplace(key, (uint32_t)m_Memos.size());
+        if (inserted) {
+            m_Memos.emplace_back(key);
+        }
+        return it->second;
+    }
+
+    void Refresh(uint32_t slot) {
+        Memo& memo = m_Memos[slot];
+        const Revision current = m_Engine.GetRevision();
+        if (memo.value && memo.verifiedAt == current) {
+            return;
+        }
+        if (memo.value && !AnyDependencyChanged(memo)) {
+            memo.verifiedAt = current;
+            return;
+        }
+        Execute(memo);
+    }
+
+    bool AnyDependencyChanged(const Memo& memo) {
+        for (const auto& dependency : memo.dependencies) {
+            if (dependency.table->MaybeChangedAfter(dependency.slot, memo.verifiedAt)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Execute(Memo& memo) {
+        if (memo.executing) {
+            std::cerr << "Cycle detected in query " << m_Name << std::endl;
+            std::abort();
+        }
+
+        memo.executing = true;
+        m_Engine.PushFrame();
+        Value value = m_Compute(memo.key);
+        memo.dependencies = m_Engine.PopFrame();
+        memo.executing = false;
+        ++m_Executions;
+
+        const Revision current = m_Engine.GetRevision();
+        memo.verifiedAt = current;
+        if constexpr (Backdate) {
+            if (memo.value && *memo.value == value) {
+                return;
+            }
+        }
+        memo.value = MakeShared<const Value>(std::move(value));
+        memo.changedAt = current;
+    }
+
+    Compute m_Compute;
+    HashMap<Key, uint32_t> m_Slots;
+    std::deque<Memo> m_Memos;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "CommonTypes.h"
+
+#include <mutex>
+#include <string_view>
+
+// String-keyed map for symbol collection from many threads at once.
+// Keys are spread over independently locked shards (lock striping), and each
+// shard is a flat open-addressing table with linear probing, so inserts from
+// different threads rarely contend and no entry is separately heap-allocated.
+template <typename T, size_t ShardCount = 64>
+class ShardedSymbolTable {
+public:
+    // Inserts name -> value unless name is already present. On a duplicate the
+    // table is left unchanged, the existing value is stored in *existing (if
+    // given) and false is returned.
+    bool Insert(std::string_view name, T value, T* existing = nullptr) {
+        const size_t hash = HashName(name);
+        Shard& shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        if ((shard.count + 1) * 4 > shard.slots.size() * 3) {
+            Grow(shard);
+        }
+
+        Slot& slot = Probe(shard, hash, name);
+        if (slot.used) {
+            if (existing) {
+                *existing = slot.value;
+            }
+            return false;
+        }
+
+        slot.hash = hash;
+        slot.name = String(name);
+        slot.value = std::move(value);
+        slot.used = true;
+        ++shard.count;
+        return true;
+    }
+
+    bool Find(std::string_view name, T& value) const {
+        const size_t hash = HashName(name);
+        Shard& shard = GetShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        if (shard.slots.empty()) {
+            return false;
+        }
+
+        const Slot& slot = Probe(shard, hash, name);
+        if (slot.used) {
+            value = slot.value;
+        }
+        return slot.used;
+    }
+
+    // Calls func(const String& name, const T& value) for every entry.
+    // Must not run concurrently with Insert on the same table.
+    template <typename Func>
+    void ForEach(Func&& func) const {
+        for (const Shard& shard : m_Shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const Slot& slot : shard.slots) {
+                if (slot.used) {
+                    func(slot.name, slot.value);
+                }
+            }
+        }
+    }
+
+    size_t Size() const {
+        size_t size = 0;
+        for (const Shard& shard : m_Shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size += shard.count;
+        }
+        return size;
+    }
+
+private:
+    struct Slot {
+        size_t hash = 0;
+        String name;
+        T value = {};
+        bool used = false;
+    };
+
+    // Cache-line aligned so neighbouring shard locks don't false-share
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        Vector<Slot> slots;
+        size_t count = 0;
+    };
+
+    static size_t HashName(std::string_view name) {
+        return std::hash<std::string_view>()(name);
+    }
+
+    Shard& GetShard(size_t hash) const {
+        return m_Shards[hash % ShardCount];
+    }
+
+    static Slot& Probe(Shard& shard, size_t hash, std::string_view name) {
+        const size_t mask = shard.slots.size() - 1;
+        size_t index = (hash / ShardCount) & mask;
+        while (shard.slots[index].used) {
+            const Slot& slot = shard.slots[index];
+            if (slot.hash == hash && slot.name == name) {
+                break;
+            }
+            index = (index + 1) & mask;
+        }
+        return shard.slots[index];
+    }
+
+    static void Grow(Shard& shard) {
+        Vector<Slot> old = std::move(shard.slots);
+        shard.slots = Vector<Slot>(old.empty() ? 16 : old.size() * 2);
+        for (Slot& slot : old) {
+            if (slot.used) {
+                Slot& target = Probe(shard, slot.hash, slot.name);
+                target = std::move(slot);
+            }
+        }
+    }
+
+    mutable Shard m_Shards[ShardCount];
+};
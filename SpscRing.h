@@ -0,0 +1,133 @@
+#pragma once
+
+#include "CommonTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZIX_SPIN_PAUSE() _mm_pause()
+#else
+#define ZIX_SPIN_PAUSE() ((void)0)
+#endif
+
+// Time a pipeline stage spent waiting on a full or empty ring
+struct StallTime {
+    int64_t nanoseconds = 0;
+    uint64_t count = 0;
+
+    double GetMilliseconds() const {
+        return nanoseconds / 1e6;
+    }
+};
+
+// Bounded lock-free ring for exactly one producer and one consumer thread.
+// The head (consumer) and tail (producer) indices live on separate cache
+// lines and each side caches the other's index, so the shared lines are
+// only read when the ring looks full or empty. Push() blocks while the ring
+// is full, which is what gives a pipeline its backpressure.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_Slots.resize(size);
+        m_Mask = size - 1;
+    }
+
+    bool TryPush(T& value) {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_CachedHead > m_Mask) {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead > m_Mask) {
+                return false;
+            }
+        }
+        m_Slots[tail & m_Mask] = std::move(value);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value) {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_CachedTail) {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail) {
+                return false;
+            }
+        }
+        value = std::move(m_Slots[head & m_Mask]);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void Push(T value, StallTime& stall) {
+        if (TryPush(value)) {
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (int spins = 0; !TryPush(value); ++spins) {
+            Backoff(spins);
+        }
+        AddStall(stall, start);
+    }
+
+    // Returns false once the producer has closed the ring and it is drained
+    bool Pop(T& value, StallTime& stall) {
+        if (TryPop(value)) {
+            return true;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        for (int spins = 0;; ++spins) {
+            // Read closed before retrying, so an item pushed right before
+            // Close() is still seen
+            const bool closed = m_Closed.load(std::memory_order_acquire);
+            if (TryPop(value)) {
+                AddStall(stall, start);
+                return true;
+            }
+            if (closed) {
+                AddStall(stall, start);
+                return false;
+            }
+            Backoff(spins);
+        }
+    }
+
+    void Close() {
+        m_Closed.store(true, std::memory_order_release);
+    }
+
+private:
+    static void Backoff(int spins) {
+        if (spins < 64) {
+            ZIX_SPIN_PAUSE();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    static void AddStall(StallTime& stall, std::chrono::steady_clock::time_point start) {
+        stall.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ++stall.count;
+    }
+
+    Vector<T> m_Slots;
+    size_t m_Mask = 0;
+
+    alignas(64) std::atomic<size_t> m_Head = 0;
+    size_t m_CachedTail = 0;
+
+    alignas(64) std::atomic<size_t> m_Tail = 0;
+    size_t m_CachedHead = 0;
+
+    alignas(64) std::atomic<bool> m_Closed = false;
+};
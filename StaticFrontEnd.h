@@ -0,0 +1,585 @@
+#pragma once
+
+#include "ASTNode.h"
+#include "Token.h"
+#include "UnicodeTables.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// constexpr lexer and parser for zix snippets embedded in C++ as string
+// literals. They accept the same language as Lexer.h/Parser.h but write into
+// fixed-size tables sized from the source at compile time, so
+//
+//     ZIX_STATIC_PROGRAM(Script, "fn main() -> i32 { let x = 1; }");
+//
+// costs nothing at startup and a syntax error fails the build. Identifier
+// and string tokens are views into the literal. There is no error recovery:
+// the first error stops parsing and is kept in the program.
+
+namespace StaticFrontEnd
+{
+    inline constexpr uint32_t NoNode = UINT32_MAX;
+
+    struct StaticToken {
+        TokenType type = TokenType::INVALID;
+        uint32_t begin = 0;
+        uint32_t length = 0;
+        int value = 0;
+        Location location = { 1, 1 };
+    };
+
+    // Nodes refer to their tokens and children by index. Children are the
+    // node's ASTNodeRef properties in declaration order; the statements of a
+    // TopStatements are chained through next. A function's parameters are
+    // the name tokens firstParam, firstParam + 4, ... each followed by
+    // ':' and the type; returnType is the token of its return type.
+    struct StaticASTNode {
+        ASTNodeKind kind = ASTNodeKind::TopStatements;
+        uint32_t token = 0;
+        std::array<uint32_t, 4> children = { NoNode, NoNode, NoNode, NoNode };
+        uint32_t next = NoNode;
+        uint32_t firstParam = 0;
+        uint32_t paramCount = 0;
+        uint32_t returnType = 0;
+    };
+
+    struct StaticError {
+        const char* message = nullptr;
+        Location location = { 1, 1 };
+    };
+
+    template <size_t MaxTokens>
+    struct StaticProgram {
+        std::string_view source;
+        std::array<StaticToken, MaxTokens> tokens{};
+        size_t tokenCount = 0;
+        // Every node owns a distinct token, so the token count bounds them
+        std::array<StaticASTNode, MaxTokens> nodes{};
+        size_t nodeCount = 0;
+        uint32_t root = NoNode;
+        StaticError error;
+
+        constexpr bool IsOk() const {
+            return error.message == nullptr;
+        }
+
+        constexpr std::string_view GetText(uint32_t token) const {
+            return source.substr(tokens[token].begin, tokens[token].length);
+        }
+    };
+
+    constexpr bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    // Offset of the next token after whitespace and comments, matching the
+    // runtime lexer. Sets unterminated if a block comment never closes.
+    constexpr size_t SkipSpaceAndComments(std::string_view source, size_t offset, bool& unterminated) {
+        while (offset < source.size()) {
+            const bool slash = source[offset] == '/' && offset + 1 < source.size();
+            if (IsSpace(source[offset])) {
+                ++offset;
+            } else if (slash && source[offset + 1] == '/') {
+                while (offset < source.size() && source[offset] != '\n') ++offset;
+            } else if (slash && source[offset + 1] == '*') {
+                const size_t close = source.find("*/", offset + 2);
+                if (close == std::string_view::npos) {
+                    unterminated = true;
+                    return source.size();
+                }
+                offset = close + 2;
+            } else {
+                break;
+            }
+        }
+        return offset;
+    }
+
+    constexpr bool IsAsciiIdentifierChar(char c, bool isStart) {
+        const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        return letter || (!isStart && c >= '0' && c <= '9');
+    }
+
+    template <size_t N>
+    constexpr bool IsInRanges(const UnicodeRange (&ranges)[N], char32_t codePoint) {
+        size_t low = 0, high = N;
+        while (low < high) {
+            const size_t mid = (low + high) / 2;
+            if (codePoint < ranges[mid].first) {
+                high = mid;
+            } else if (codePoint > ranges[mid].last) {
+                low = mid + 1;
+            } else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Byte length of the identifier character at offset, 0 if there is none.
+    // Mirrors GetIdentifierCharLength, including its strict UTF-8 decoding.
+    constexpr int GetIdentifierCharLength(std::string_view source, size_t offset, bool isStart) {
+        if (offset >= source.size()) {
+            return 0;
+        }
+        const unsigned char lead = (unsigned char)source[offset];
+        if (lead < 0x80) {
+            return IsAsciiIdentifierChar((char)lead, isStart) ? 1 : 0;
+        }
+
+        int length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC2 ? 2 : 0;
+        if (length == 0 || lead > 0xF4 || offset + length > source.size()) {
+            return 0;
+        }
+        char32_t codePoint = lead & (0x7F >> length);
+        for (int i = 1; i < length; ++i) {
+            const unsigned char byte = (unsigned char)source[offset + i];
+            if ((byte & 0xC0) != 0x80) return 0;
+            codePoint = (codePoint << 6) | (byte & 0x3F);
+        }
+        const char32_t minimum = length == 2 ? 0x80 : length == 3 ? 0x800 : 0x10000;
+        if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return 0;
+        }
+
+        const bool accepted = isStart ? IsInRanges(XIDStartRanges, codePoint) : IsInRanges(XIDContinueRanges, codePoint);
+        return accepted ? length : 0;
+    }
+
+#define STATIC_MONOSTATE_STRING_CASE(TOKEN_STRING, TOKEN_NAME) \
+    case TokenType::TOKEN_NAME: return TOKEN_STRING;
+
+    constexpr std::string_view GetMonostateTokenString(TokenType type) {
+        switch (type) {
+            MONOSTATE_TOKEN_LIST(STATIC_MONOSTATE_STRING_CASE)
+            default: return {};
+        }
+    }
+
+#undef STATIC_MONOSTATE_STRING_CASE
+
+#define STATIC_TOKEN_ORDER(NAME) TokenType::NAME,
+
+    // Token types in the order TryParseNextToken tries them
+    inline constexpr TokenType TokenOrder[] = { TOKEN_LIST(STATIC_TOKEN_ORDER) };
+
+#undef STATIC_TOKEN_ORDER
+
+    // Lexes one token at offset. Returns its byte length, 0 if no token
+    // type matches.
+    constexpr size_t LexToken(std::string_view source, size_t offset, StaticToken& token) {
+        const std::string_view rest = source.substr(offset);
+        for (TokenType type : TokenOrder) {
+            const std::string_view text = GetMonostateTokenString(type);
+            if (!text.empty()) {
+                if (rest.substr(0, text.size()) != text) continue;
+                // Keeps keywords from matching the start of a longer identifier
+                const bool isKeyword = IsAsciiIdentifierChar(text[0], true);
+                if (isKeyword && GetIdentifierCharLength(source, offset + text.size(), false) > 0) continue;
+                token.type = type;
+                return text.size();
+            }
+
+            switch (type) {
+                case TokenType::INT_LITERAL: {
+                    size_t length = 0;
+                    int64_t value = 0;
+                    while (length < rest.size() && rest[length] >= '0' && rest[length] <= '9') {
+                        // Clamped so the literal can't overflow during constant evaluation
+                        value = value * 10 + (rest[length] - '0');
+                        value = value > INT32_MAX ? int64_t(INT32_MAX) + 1 : value;
+                        ++length;
+                    }
+                    const bool letterFollows = length < rest.size() &&
+                        ((rest[length] >= 'a' && rest[length] <= 'z') || (rest[length] >= 'A' && rest[length] <= 'Z'));
+                    if (length == 0 || letterFollows) continue;
+                    token.type = type;
+                    token.value = (int)(value > INT32_MAX ? INT32_MAX : value);
+                    return length;
+                }
+
+                case TokenType::STR_LITERAL: {
+                    if (rest.empty() || rest[0] != '"') continue;
+                    const size_t close = rest.find('"', 1);
+                    if (close == std::string_view::npos) continue;
+                    token.type = type;
+                    token.begin = (uint32_t)offset + 1;
+                    token.length = (uint32_t)close - 1;
+                    return close + 1;
+                }
+
+                case TokenType::IDENTIFIER: {
+                    size_t length = GetIdentifierCharLength(source, offset, true);
+                    if (length == 0) continue;
+                    while (int next = GetIdentifierCharLength(source, offset + length, false)) {
+                        length += next;
+                    }
+                    token.type = type;
+                    return length;
+                }
+
+                default:
+                    continue;
+            }
+        }
+        return 0;
+    }
+
+    // Number of tokens in source including END_OF_FILE, used to size the
+    // tables. Input that doesn't lex still needs a slot for the error.
+    constexpr size_t CountTokens(std::string_view source) {
+        size_t count = 1;
+        size_t offset = 0;
+        while (true) {
+            bool unterminated = false;
+            offset = SkipSpaceAndComments(source, offset, unterminated);
+            if (offset >= source.size() || source[offset] == '\0') return count;
+
+            StaticToken token;
+            const size_t length = LexToken(source, offset, token);
+            if (length == 0) return count;
+            offset += length;
+            ++count;
+        }
+    }
+
+    template <size_t MaxTokens>
+    class StaticParser {
+    public:
+        constexpr explicit StaticParser(StaticProgram<MaxTokens>& program)
+            : m_Program(program)
+        {}
+
+        constexpr void Tokenize() {
+            const std::string_view source = m_Program.source;
+            Location location = { 1, 1 };
+            size_t offset = 0;
+
+            auto Advance = [&](size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    const char c = source[offset + i];
+                    if (c == '\n') {
+                        location = { location.line + 1, 1 };
+                    } else if ((c & 0xC0) != 0x80) {
+                        location.column++;
+                    }
+                }
+                offset += count;
+            };
+
+            while (true) {
+                const Location commentBegin = location;
+                bool unterminated = false;
+                Advance(SkipSpaceAndComments(source, offset, unterminated) - offset);
+
+                StaticToken& token = m_Program.tokens[m_Program.tokenCount++];
+                token.location = location;
+                token.begin = (uint32_t)offset;
+                if (unterminated) {
+                    token.type = TokenType::END_OF_FILE;
+                    Fail("unterminated block comment", commentBegin);
+                    return;
+                }
+                if (offset >= source.size() || source[offset] == '\0') {
+                    token.type = TokenType::END_OF_FILE;
+                    return;
+                }
+
+                const size_t length = LexToken(source, offset, token);
+                if (length == 0) {
+                    token.type = TokenType::END_OF_FILE;
+                    Fail("invalid token", location);
+                    return;
+                }
+                if (token.type != TokenType::STR_LITERAL) {
+                    token.length = (uint32_t)length;
+                }
+                Advance(length);
+            }
+        }
+
+        constexpr void Parse() {
+            if (m_Program.IsOk()) {
+                m_Program.root = ParseTopStatements(m_Program.tokenCount - 1);
+            }
+        }
+
+    private:
+        constexpr TokenType Peek(size_t lookAhead = 0) const {
+            const size_t index = m_Current + lookAhead;
+            return index < m_Program.tokenCount ? m_Program.tokens[index].type : TokenType::END_OF_FILE;
+        }
+
+        constexpr bool Consume(TokenType type) {
+            if (Peek() == type) {
+                ++m_Current;
+                return true;
+            }
+            return false;
+        }
+
+        constexpr bool Expect(TokenType type, const char* message) {
+            if (Consume(type)) {
+                return true;
+            }
+            Fail(message, m_Program.tokens[m_Current].location);
+            return false;
+        }
+
+        constexpr void Fail(const char* message, Location location) {
+            if (m_Program.IsOk()) {
+                m_Program.error = StaticError{ message, location };
+            }
+        }
+
+        constexpr uint32_t AddNode(ASTNodeKind kind, size_t token) {
+            StaticASTNode& node = m_Program.nodes[m_Program.nodeCount];
+            node.kind = kind;
+            node.token = (uint32_t)token;
+            return (uint32_t)m_Program.nodeCount++;
+        }
+
+        constexpr StaticASTNode& Node(uint32_t index) {
+            return m_Program.nodes[index];
+        }
+
+        // Statements up to END_OF_FILE, or up to '}' inside a block. token is
+        // the one the node is attributed to: EOF for the root, '{' for blocks.
+        constexpr uint32_t ParseTopStatements(size_t token) {
+            const uint32_t node = AddNode(ASTNodeKind::TopStatements, token);
+            uint32_t last = NoNode;
+            while (m_Program.IsOk() && Peek() != TokenType::END_OF_FILE && !(m_BlockDepth > 0 && Peek() == TokenType::RCURLY)) {
+                const uint32_t statement = ParseTopStatement();
+                if (statement == NoNode) {
+                    break;
+                }
+                if (last == NoNode) {
+                    Node(node).children[0] = statement;
+                } else {
+                    Node(last).next = statement;
+                }
+                last = statement;
+            }
+            return node;
+        }
+
+        constexpr uint32_t ParseTopStatement() {
+            switch (Peek()) {
+                case TokenType::FUNCTION: return ParseFunctionDeclaration();
+                case TokenType::LET: return ParseVariableDeclaration();
+                case TokenType::FOR: return ParseForStatement();
+                default:
+                    Fail("unexpected token", m_Program.tokens[m_Current].location);
+                    return NoNode;
+            }
+        }
+
+        constexpr uint32_t ParseBlock() {
+            const size_t open = m_Current;
+            if (!Expect(TokenType::LCURLY, "expected '{'")) {
+                return NoNode;
+            }
+            ++m_BlockDepth;
+            const uint32_t block = ParseTopStatements(open);
+            --m_BlockDepth;
+            return Expect(TokenType::RCURLY, "expected '}'") ? block : NoNode;
+        }
+
+        constexpr uint32_t ParseFunctionDeclaration() {
+            const uint32_t node = AddNode(ASTNodeKind::FunctionDeclaration, m_Current);
+            Consume(TokenType::FUNCTION);
+            if (!Expect(TokenType::IDENTIFIER, "expected function name") || !Expect(TokenType::LPAREN, "expected '('")) {
+                return NoNode;
+            }
+
+            Node(node).firstParam = (uint32_t)m_Current;
+            while (Peek() == TokenType::IDENTIFIER) {
+                Consume(TokenType::IDENTIFIER);
+                if (!Expect(TokenType::COLON, "expected ':'") || !Expect(TokenType::IDENTIFIER, "expected parameter type")) {
+                    return NoNode;
+                }
+                ++Node(node).paramCount;
+                if (!Consume(TokenType::COMMA)) {
+                    break;
+                }
+            }
+
+            if (!Expect(TokenType::RPAREN, "expected ')'") || !Expect(TokenType::ARROW, "expected '->'")) {
+                return NoNode;
+            }
+            Node(node).returnType = (uint32_t)m_Current;
+            if (!Expect(TokenType::IDENTIFIER, "expected return type")) {
+                return NoNode;
+            }
+            Node(node).children[0] = ParseBlock();
+            return m_Program.IsOk() ? node : NoNode;
+        }
+
+        constexpr uint32_t ParseVariableDeclaration() {
+            Consume(TokenType::LET);
+            const uint32_t node = AddNode(ASTNodeKind::VariableDeclaration, m_Current);
+            if (!Expect(TokenType::IDENTIFIER, "expected variable name") || !Expect(TokenType::EQUALS, "expected '='")) {
+                return NoNode;
+            }
+            Node(node).children[0] = ParseBinaryExpression(1);
+            return Expect(TokenType::SEMI_COLON, "expected ';'") ? node : NoNode;
+        }
+
+        constexpr uint32_t ParseForStatement() {
+            const uint32_t node = AddNode(ASTNodeKind::ForStatement, m_Current);
+            Consume(TokenType::FOR);
+            if (!Expect(TokenType::LPAREN, "expected '('")) {
+                return NoNode;
+            }
+            if (Peek() != TokenType::LET) {
+                Fail("expected 'let'", m_Program.tokens[m_Current].location);
+                return NoNode;
+            }
+
+            Node(node).children[0] = ParseVariableDeclaration();
+            Node(node).children[1] = ParseBinaryExpression(1);
+            if (!Expect(TokenType::SEMI_COLON, "expected ';'")) {
+                return NoNode;
+            }
+            Node(node).children[2] = ParseAssignmentExpression();
+            if (!Expect(TokenType::RPAREN, "expected ')'")) {
+                return NoNode;
+            }
+            Node(node).children[3] = ParseBlock();
+            return m_Program.IsOk() ? node : NoNode;
+        }
+
+        constexpr uint32_t ParseAssignmentExpression() {
+            if (Peek() != TokenType::IDENTIFIER || Peek(1) != TokenType::EQUALS) {
+                return ParseBinaryExpression(1);
+            }
+
+            const uint32_t target = AddNode(ASTNodeKind::IdentifierExpression, m_Current);
+            Consume(TokenType::IDENTIFIER);
+            const uint32_t node = AddNode(ASTNodeKind::AssignmentExpression, m_Current);
+            Consume(TokenType::EQUALS);
+            Node(node).children[0] = target;
+            Node(node).children[1] = ParseBinaryExpression(1);
+            return node;
+        }
+
+        static constexpr int GetBinaryPrecedence(TokenType type) {
+            switch (type) {
+                case TokenType::LESS:
+                case TokenType::GREATER:
+                    return 1;
+                case TokenType::PLUS:
+                case TokenType::MINUS:
+                    return 2;
+                case TokenType::STAR:
+                case TokenType::SLASH:
+                    return 3;
+                default:
+                    return 0;
+            }
+        }
+
+        // Precedence climbing; left-associative like Parser's operator stacks
+        constexpr uint32_t ParseBinaryExpression(int minPrecedence) {
+            uint32_t left = ParsePrimaryExpression();
+            while (m_Program.IsOk()) {
+                const int precedence = GetBinaryPrecedence(Peek());
+                if (precedence == 0 || precedence < minPrecedence) {
+                    break;
+                }
+                const uint32_t node = AddNode(ASTNodeKind::BinaryExpression, m_Current++);
+                Node(node).children[0] = left;
+                Node(node).children[1] = ParseBinaryExpression(precedence + 1);
+                left = node;
+            }
+            return left;
+        }
+
+        constexpr uint32_t ParsePrimaryExpression() {
+            const size_t token = m_Current;
+            if (Consume(TokenType::INT_LITERAL)) {
+                return AddNode(ASTNodeKind::IntegerLiteralExpression, token);
+            }
+            if (Consume(TokenType::IDENTIFIER)) {
+                return AddNode(ASTNodeKind::IdentifierExpression, token);
+            }
+            if (Consume(TokenType::LPAREN)) {
+                const uint32_t inner = ParseBinaryExpression(1);
+                return Expect(TokenType::RPAREN, "expected ')'") ? inner : NoNode;
+            }
+            Fail("expected expression", m_Program.tokens[token].location);
+            return NoNode;
+        }
+
+        StaticProgram<MaxTokens>& m_Program;
+        size_t m_Current = 0;
+        int m_BlockDepth = 0;
+    };
+
+    template <size_t MaxTokens>
+    constexpr StaticProgram<MaxTokens> ParseProgram(std::string_view source) {
+        StaticProgram<MaxTokens> program;
+        program.source = source;
+        StaticParser<MaxTokens> parser(program);
+        parser.Tokenize();
+        parser.Parse();
+        return program;
+    }
+
+    // Builds the regular AST from a parsed table so embedded programs can go
+    // through NameResolver, TypeChecker and the backends
+    template <size_t MaxTokens>
+    ASTNodeRef BuildAST(const StaticProgram<MaxTokens>& program, uint32_t index) {
+        if (index == NoNode) {
+            return nullptr;
+        }
+
+        const StaticASTNode& node = program.nodes[index];
+        auto Text = [&](uint32_t token) { return String(program.GetText(token)); };
+        auto Child = [&](int i) { return BuildAST(program, node.children[i]); };
+
+        switch (node.kind) {
+            case ASTNodeKind::TopStatements: {
+                Vector<ASTNodeRef> statements;
+                for (uint32_t stat = node.children[0]; stat != NoNode; stat = program.nodes[stat].next) {
+                    statements.push_back(BuildAST(program, stat));
+                }
+                return MakeShared<TopStatements>(statements);
+            }
+            case ASTNodeKind::ForStatement:
+                return MakeShared<ForStatement>(Child(0), Child(1), Child(2), Child(3));
+            case ASTNodeKind::FunctionDeclaration: {
+                Vector<FuncParam> params;
+                for (uint32_t i = 0; i < node.paramCount; ++i) {
+                    const uint32_t name = node.firstParam + 4 * i;
+                    params.push_back(FuncParam{ Text(name), Text(name + 2) });
+                }
+                return MakeShared<FunctionDeclaration>(Text(node.token + 1), params, Text(node.returnType), Child(0));
+            }
+            case ASTNodeKind::VariableDeclaration:
+                return MakeShared<VariableDeclaration>(Text(node.token), Child(0));
+            case ASTNodeKind::IntegerLiteralExpression:
+                return MakeShared<IntegerLiteralExpression>(program.tokens[node.token].value, LiteralType{});
+            case ASTNodeKind::IdentifierExpression:
+                return MakeShared<IdentifierExpression>(Text(node.token), NameBinding{});
+            case ASTNodeKind::BinaryExpression:
+                return MakeShared<BinaryExpression>(program.tokens[node.token].type, Child(0), Child(1));
+            case ASTNodeKind::AssignmentExpression:
+                return MakeShared<AssignmentExpression>(Child(0), Child(1));
+        }
+        return nullptr;
+    }
+
+    template <size_t MaxTokens>
+    ASTNodeRef BuildAST(const StaticProgram<MaxTokens>& program) {
+        return BuildAST(program, program.root);
+    }
+}
+
+#define ZIX_STATIC_PROGRAM(NAME, SOURCE)                                                                   \
+    static constexpr auto NAME =                                                                           \
+        StaticFrontEnd::ParseProgram<StaticFrontEnd::CountTokens(SOURCE)>(SOURCE);                         \
+    static_assert(NAME.IsOk(), "syntax error in embedded zix program " #NAME)
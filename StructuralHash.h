@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// 128-bit hash identifying an AST subtree by structure. Equal subtrees get
+// equal hashes; with 128 bits an accidental collision is negligible, so
+// callers may treat equal hashes as equal trees.
+struct StructuralHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const StructuralHash& other) const {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const StructuralHash& other) const {
+        return !(*this == other);
+    }
+};
+
+// Accumulates words into two independently mixed 64-bit lanes. Each word is
+// folded in with a multiply-xorshift step, and Finish() runs both lanes
+// through a final avalanche so every input bit affects every output bit.
+class StructuralHasher {
+public:
+    explicit StructuralHasher(uint64_t seed)
+        : m_Low(seed ^ 0x9E3779B97F4A7C15ull), m_High(seed ^ 0xC2B2AE3D27D4EB4Full)
+    {}
+
+    void Add(uint64_t word) {
+        m_Low = Mix((m_Low ^ word) * 0xBF58476D1CE4E5B9ull);
+        m_High = Mix((m_High + word) * 0x94D049BB133111EBull);
+        ++m_Count;
+    }
+
+    void Add(const StructuralHash& hash) {
+        Add(hash.low);
+        Add(hash.high);
+    }
+
+    // Length first, so adjacent strings can't run together
+    void Add(std::string_view text) {
+        Add((uint64_t)text.size());
+        size_t i = 0;
+        for (; i + 8 <= text.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, text.data() + i, sizeof(word));
+            Add(word);
+        }
+        if (i < text.size()) {
+            uint64_t word = 0;
+            std::memcpy(&word, text.data() + i, text.size() - i);
+            Add(word);
+        }
+    }
+
+    StructuralHash Finish() const {
+        const uint64_t low = Mix(m_Low ^ m_Count);
+        const uint64_t high = Mix(m_High + low);
+        return StructuralHash{ low, high };
+    }
+
+private:
+    static uint64_t Mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+
+    uint64_t m_Low;
+    uint64_t m_High;
+    uint64_t m_Count = 0;
+};
@@ -13,6 +13,8 @@
     MACRO(FOR)            \
     MACRO(LET)            \
     MACRO(ARROW)          \
+    MACRO(LESS)           \
+    MACRO(GREATER)        \
     MACRO(RETURN)         \
     MACRO(EQUALS)         \
     MACRO(PLUS)           \
@@ -30,6 +32,7 @@
     MACRO(DOT)            \
     MACRO(COMMA)          \
     MACRO(IDENTIFIER)     \
+    MACRO(COMMENT)        \
     MACRO(END_OF_FILE)
 
 // Tokens that don't have any more
@@ -41,6 +44,8 @@
     MACRO("let", LET)               \
     MACRO("=", EQUALS)              \
     MACRO("->", ARROW)              \
+    MACRO("<", LESS)                \
+    MACRO(">", GREATER)             \
     MACRO("return", RETURN)         \
     MACRO("+", PLUS)                \
     MACRO("-", MINUS)               \
@@ -76,6 +81,7 @@ struct Token {
     TokenType type;
     TokenData data;
     Location location;
+    Location endLocation;
 };
 
 template <TokenType TType>
@@ -94,7 +100,7 @@ Token CreateTokenData(ValueType value, Location location) {
 }
 
 struct DebugValueVisitor {
-    void operator()(const std::string& value) {
+    void operator()(const String& value) {
         std::cout << "(String: " << value << ')';
     }
 
@@ -105,7 +111,7 @@ struct DebugValueVisitor {
     void operator()(std::monostate value) {}
 };
 
-static const char* GetTokenName(TokenType token) {
+inline const char* GetTokenName(TokenType token) {
     #define RETURN_TOKEN_NAME(NAME) case TokenType::NAME: return #NAME;
     switch (token) {
         TOKEN_LIST(RETURN_TOKEN_NAME);
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "BufferedWriter.h"
+#include "Lexer.h"
+#include "Token.h"
+
+#include <cctype>
+#include <charconv>
+#include <string_view>
+
+// Source formatter (zixfmt) that works on the token stream alone: one
+// linear pass, one token of state, nothing allocated per token beyond what
+// the lexer produces. Indentation follows LCURLY/RCURLY, statements end at
+// SEMI_COLON (except inside a for header), and spacing is decided by the
+// class of the previous and current token. Comments are kept: one on the
+// same line as the token before it stays there, any other gets a line of
+// its own.
+class TokenFormatter {
+public:
+    explicit TokenFormatter(BufferedWriter& output)
+        : m_Output(output)
+    {}
+
+    // Streams tokens straight from the lexer without building a TokenList
+    void Format(Lexer& lexer, DiagnosticEngine& diagnostics) {
+        TRACE_SCOPE_FILE("TokenFormatter", lexer.GetFilename());
+        if (!ValidateEncoding(lexer, diagnostics)) {
+            return;
+        }
+        lexer.KeepComments();
+
+        Token token;
+        while (LexNextToken(lexer, token, diagnostics)) {
+            Write(token, GetLiteralSpelling(lexer, token));
+        }
+    }
+
+    void Format(const TokenList& tokens) {
+        for (const auto& token : tokens) {
+            Write(token);
+        }
+    }
+
+private:
+    // An integer literal is written as it was spelled: its decoded value
+    // would turn 0042 into 42 and wraps past INT32_MAX. The token just
+    // lexed ends at the lexer's offset and is a maximal run of digits.
+    static std::string_view GetLiteralSpelling(const Lexer& lexer, const Token& token) {
+        if (token.type != TokenType::INT_LITERAL) {
+            return {};
+        }
+        const int end = lexer.GetOffset();
+        int begin = end;
+        while (begin > 0 && std::isdigit((unsigned char)lexer.GetView(begin - 1, begin)[0])) {
+            --begin;
+        }
+        return lexer.GetView(begin, end);
+    }
+
+    enum class Spacing {
+        Word,           // keywords, identifiers and literals
+        Operator,       // spaced on both sides
+        OpenParen,
+        CloseParen,
+        Separator,      // , ; : are attached left and spaced right
+        Dot,
+        OpenBlock,
+        CloseBlock,
+        None,
+    };
+
+#define TOKEN_SPACING_CASE(TOKEN_STRING, TOKEN_NAME) \
+    case TokenType::TOKEN_NAME: return GetMonostateSpacing(TOKEN_STRING);
+
+    static Spacing GetSpacing(TokenType type) {
+        switch (type) {
+            MONOSTATE_TOKEN_LIST(TOKEN_SPACING_CASE)
+            case TokenType::INT_LITERAL:
+            case TokenType::STR_LITERAL:
+            case TokenType::IDENTIFIER:
+                return Spacing::Word;
+            default:
+                return Spacing::None;
+        }
+    }
+
+#undef TOKEN_SPACING_CASE
+
+    static constexpr Spacing GetMonostateSpacing(const char* text) {
+        switch (text[0]) {
+            case '(': return Spacing::OpenParen;
+            case ')': return Spacing::CloseParen;
+            case '{': return Spacing::OpenBlock;
+            case '}': return Spacing::CloseBlock;
+            case ',':
+            case ';':
+            case ':': return Spacing::Separator;
+            case '.': return Spacing::Dot;
+            default:
+                return (text[0] >= 'a' && text[0] <= 'z') ? Spacing::Word : Spacing::Operator;
+        }
+    }
+
+#define TOKEN_TEXT_CASE(TOKEN_STRING, TOKEN_NAME) \
+    case TokenType::TOKEN_NAME: m_Output.Write(TOKEN_STRING, STR_LIT_LEN(TOKEN_STRING)); break;
+
+    void WriteText(const Token& token, std::string_view spelling) {
+        switch (token.type) {
+            MONOSTATE_TOKEN_LIST(TOKEN_TEXT_CASE)
+
+            case TokenType::IDENTIFIER: {
+                const String& name = std::get<String>(token.data);
+                m_Output.Write(name.data(), name.size());
+                break;
+            }
+
+            case TokenType::STR_LITERAL: {
+                const String& value = std::get<String>(token.data);
+                m_Output.Put('"');
+                m_Output.Write(value.data(), value.size());
+                m_Output.Put('"');
+                break;
+            }
+
+            case TokenType::INT_LITERAL: {
+                if (!spelling.empty()) {
+                    m_Output.Write(spelling.data(), spelling.size());
+                    break;
+                }
+                char digits[16];
+                auto result = std::to_chars(digits, digits + sizeof(digits), std::get<int>(token.data));
+                m_Output.Write(digits, result.ptr - digits);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+#undef TOKEN_TEXT_CASE
+
+    void Write(const Token& token, std::string_view spelling = {}) {
+        if (token.type == TokenType::END_OF_FILE) {
+            if (!m_AtLineStart || m_NewLinePending) {
+                m_Output.Put('\n');
+            }
+            return;
+        }
+        if (token.type == TokenType::COMMENT) {
+            WriteComment(token);
+            return;
+        }
+
+        const Spacing spacing = GetSpacing(token.type);
+        if (spacing == Spacing::CloseBlock) {
+            m_Depth = m_Depth > 0 ? m_Depth - 1 : 0;
+            NewLine();
+        }
+
+        if (m_AtLineStart) {
+            BeginLine(spacing != Spacing::CloseBlock);
+        } else if (NeedsSpace(m_Previous, spacing)) {
+            m_Output.Put(' ');
+        }
+
+        WriteText(token, spelling);
+        m_PreviousLine = token.endLocation.line;
+
+        switch (spacing) {
+            case Spacing::OpenParen:
+                ++m_ParenDepth;
+                break;
+            case Spacing::CloseParen:
+                m_ParenDepth = m_ParenDepth > 0 ? m_ParenDepth - 1 : 0;
+                break;
+            case Spacing::OpenBlock:
+                ++m_Depth;
+                NewLine();
+                break;
+            case Spacing::CloseBlock:
+                NewLine();
+                m_BlankLinePending = m_Depth == 0;
+                break;
+            case Spacing::Separator:
+                if (token.type == TokenType::SEMI_COLON && m_ParenDepth == 0) {
+                    NewLine();
+                }
+                break;
+            default:
+                break;
+        }
+
+        m_Previous = spacing;
+        m_PreviousType = token.type;
+    }
+
+    // A comment keeps to the line of the token before it, even when that
+    // token has ended the line; the line break is only written later
+    void WriteComment(const Token& token) {
+        const String& text = std::get<String>(token.data);
+        const bool trailing = m_Previous != Spacing::None && token.location.line == m_PreviousLine;
+        if (trailing && m_AtLineStart) {
+            m_Output.Put(' ');
+        } else if (trailing) {
+            if (NeedsSpace(m_Previous, Spacing::Word)) {
+                m_Output.Put(' ');
+            }
+        } else {
+            NewLine();
+            BeginLine(true);
+        }
+
+        m_Output.Write(text.data(), text.size());
+        m_PreviousLine = token.endLocation.line;
+
+        // Anything after a line comment would become part of it
+        if (!trailing || text[1] == '/') {
+            NewLine();
+        }
+    }
+
+    void BeginLine(bool allowBlankLine) {
+        if (m_NewLinePending) {
+            m_Output.Put('\n');
+            m_NewLinePending = false;
+        }
+        if (m_BlankLinePending && allowBlankLine) {
+            m_Output.Put('\n');
+        }
+        m_Output.Repeat(' ', 4 * m_Depth);
+        m_AtLineStart = false;
+        m_BlankLinePending = false;
+    }
+
+    bool NeedsSpace(Spacing previous, Spacing current) const {
+        switch (current) {
+            case Spacing::CloseParen:
+            case Spacing::Separator:
+            case Spacing::Dot:
+                return false;
+            case Spacing::OpenParen:
+                // Calls and declarations hug the name: `fn main(`, but `for (`
+                return !(previous == Spacing::Word && m_PreviousType == TokenType::IDENTIFIER) &&
+                       previous != Spacing::OpenParen && previous != Spacing::Dot;
+            default:
+                return previous != Spacing::OpenParen && previous != Spacing::Dot;
+        }
+    }
+
+    void NewLine() {
+        if (!m_AtLineStart) {
+            m_NewLinePending = true;
+            m_AtLineStart = true;
+        }
+    }
+
+    BufferedWriter& m_Output;
+    Spacing m_Previous = Spacing::None;
+    TokenType m_PreviousType = TokenType::INVALID;
+    int m_Depth = 0;
+    int m_ParenDepth = 0;
+    int m_PreviousLine = 0;
+    bool m_AtLineStart = true;
+    bool m_NewLinePending = false;
+    bool m_BlankLinePending = false;
+};
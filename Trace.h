@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+// Scoped trace spans dumped in Chrome's trace_event format
+// (load the output in chrome://tracing or ui.perfetto.dev).
+// Build with -DZIX_ENABLE_TRACING=0 to compile every span out.
+#ifndef ZIX_ENABLE_TRACING
+#define ZIX_ENABLE_TRACING 1
+#endif
+
+namespace Trace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        const char* name;
+        const char* file;
+        int64_t begin;
+        int64_t duration;
+    };
+
+    // Every thread appends only to its own buffer, so recording
+    // never takes a lock. The mutex guards buffer registration.
+    struct ThreadBuffer {
+        uint32_t threadId;
+        Vector<Event> events;
+    };
+
+    struct Session {
+        std::atomic<bool> enabled = false;
+        std::atomic<uint32_t> nextThreadId = 1;
+        Clock::time_point start = Clock::now();
+        std::mutex registryMutex;
+        Vector<SharedPtr<ThreadBuffer>> buffers;
+    };
+
+    inline Session& GetSession() {
+        static Session session;
+        return session;
+    }
+
+    inline ThreadBuffer& GetThreadBuffer() {
+        thread_local ThreadBuffer* buffer = [] {
+            Session& session = GetSession();
+            auto newBuffer = MakeShared<ThreadBuffer>();
+            newBuffer->threadId = session.nextThreadId++;
+            newBuffer->events.reserve(256);
+
+            std::lock_guard<std::mutex> lock(session.registryMutex);
+            session.buffers.push_back(newBuffer);
+            return newBuffer.get();
+        }();
+        return *buffer;
+    }
+
+    inline bool IsEnabled() {
+        return GetSession().enabled.load(std::memory_order_relaxed);
+    }
+
+    inline void Enable() {
+        GetSession().start = Clock::now();
+        GetSession().enabled = true;
+    }
+
+    inline int64_t ToMicroseconds(Clock::time_point time) {
+        auto elapsed = time - GetSession().start;
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    }
+
+    struct Scope {
+        explicit Scope(const char* name, const char* file = nullptr)
+            : m_Name(name), m_File(file), m_Active(IsEnabled())
+        {
+            if (m_Active) {
+                m_Begin = Clock::now();
+            }
+        }
+
+        ~Scope() {
+            if (m_Active) {
+                int64_t begin = ToMicroseconds(m_Begin);
+                int64_t end = ToMicroseconds(Clock::now());
+                GetThreadBuffer().events.push_back(Event{ m_Name, m_File, begin, end - begin });
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_Name;
+        const char* m_File;
+        bool m_Active;
+        Clock::time_point m_Begin;
+    };
+
+    inline void WriteEscaped(std::ostream& out, const char* str) {
+        for (; *str; ++str) {
+            if (*str == '"' || *str == '\\') {
+                out << '\\';
+            }
+            out << *str;
+        }
+    }
+
+    // Must only be called once all traced threads have finished.
+    inline void Dump(std::ostream& out) {
+        Session& session = GetSession();
+        std::lock_guard<std::mutex> lock(session.registryMutex);
+
+        out << "{\"traceEvents\": [";
+        bool first = true;
+        for (const auto& buffer : session.buffers) {
+            for (const Event& event : buffer->events) {
+                out << (first ? "\n" : ",\n");
+                first = false;
+
+                out << "{\"name\": \"";
+                WriteEscaped(out, event.name);
+                out << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId;
+                out << ", \"ts\": " << event.begin << ", \"dur\": " << event.duration;
+                if (event.file) {
+                    out << ", \"args\": {\"file\": \"";
+                    WriteEscaped(out, event.file);
+                    out << "\"}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+    }
+}
+
+#if ZIX_ENABLE_TRACING
+#define TRACE_SCOPE(NAME)            Trace::Scope DEFER_2(_trace_, __LINE__)(NAME)
+#define TRACE_SCOPE_FILE(NAME, FILE) Trace::Scope DEFER_2(_trace_, __LINE__)(NAME, FILE)
+#else
+#define TRACE_SCOPE(NAME)
+#define TRACE_SCOPE_FILE(NAME, FILE)
+#endif
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "ASTNode.h"
+#include "ASTWalker.h"
+#include "TypeTable.h"
+
+#include <iostream>
+
+// Single post-order pass over a name-resolved AST (see NameResolver).
+// Expression types are computed on an explicit value stack and locals are
+// typed by (depth, slot), so checking is linear in the size of the tree
+// and never hashes identifier names. Integer literals take their type from
+// context: an untyped operand takes the other operand's integer type, and
+// a value nothing constrains, such as `let x = 1;`, becomes i32. The chosen
+// type is recorded on each literal for the backends.
+class TypeChecker {
+public:
+    explicit TypeChecker(TypeTable& types)
+        : m_Types(types)
+    {}
+
+    void Check(const ASTNodeRef& root) {
+        ASTWalker::Walk(root,
+            [this](ASTNode& node) { Enter(node); return true; },
+            [this](ASTNode& node) { Leave(node); });
+    }
+
+    // Checks a program one top-level statement at a time, in order, with
+    // the same result as Check() on the whole TopStatements
+    void BeginTopLevel() {
+        m_Scopes.emplace_back();
+    }
+
+    void CheckTopLevelStatement(const ASTNodeRef& statement) {
+        Check(statement);
+    }
+
+    void EndTopLevel() {
+        m_Scopes.pop_back();
+    }
+
+    // Type of an expression or of a declaration's binding, nullptr if unchecked
+    const Type* GetType(const ASTNode* node) const {
+        auto it = m_NodeTypes.find(node);
+        return it != m_NodeTypes.end() ? it->second : nullptr;
+    }
+
+    const Vector<String>& GetErrors() const {
+        return m_Errors;
+    }
+
+    void DumpErrors(std::ostream& out = std::cerr) const {
+        for (const auto& error : m_Errors) {
+            out << "Type error: " << error << std::endl;
+        }
+    }
+
+private:
+    void Enter(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::ForStatement:
+                m_Scopes.emplace_back();
+                break;
+
+            case ASTNodeKind::FunctionDeclaration:
+                EnterFunction(static_cast<FunctionDeclaration&>(node));
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void Leave(ASTNode& node) {
+        switch (node.GetKind()) {
+            case ASTNodeKind::TopStatements:
+            case ASTNodeKind::FunctionDeclaration:
+                m_Scopes.pop_back();
+                break;
+
+            case ASTNodeKind::ForStatement: {
+                auto& loop = static_cast<ForStatement&>(node);
+                // A bare expression as the increment leaves its value above the condition's
+                if (loop.GetIncrement()->GetKind() != ASTNodeKind::AssignmentExpression) {
+                    SettleDefault(loop.GetIncrement(), PopValue());
+                }
+                const Type* condition = SettleDefault(loop.GetCondition(), PopValue());
+                if (condition != m_Types.GetError() && condition->kind != Type::Kind::Bool && !condition->IsInteger()) {
+                    m_Errors.push_back("for condition must be bool or integer, not " + condition->name);
+                }
+                m_Scopes.pop_back();
+                break;
+            }
+
+            case ASTNodeKind::AssignmentExpression: {
+                const Type* value = PopValue();
+                const Type* target = PopValue();
+                const Type* error = m_Types.GetError();
+                if (value == m_Types.GetUntypedInteger() && target->IsInteger()) {
+                    value = Settle(static_cast<AssignmentExpression&>(node).GetValue(), target);
+                }
+                if (value != error && target != error && value != target) {
+                    m_Errors.push_back("cannot assign " + value->name + " to " + target->name);
+                }
+                m_NodeTypes[&node] = target;
+                break;
+            }
+
+            case ASTNodeKind::VariableDeclaration: {
+                const Type* type = SettleDefault(static_cast<VariableDeclaration&>(node).GetInitialValue(), PopValue());
+                m_NodeTypes[&node] = type;
+                if (!m_Scopes.empty()) {
+                    m_Scopes.back().push_back(type);
+                }
+                break;
+            }
+
+            case ASTNodeKind::IntegerLiteralExpression:
+                PushValue(node, m_Types.GetUntypedInteger());
+                break;
+
+            case ASTNodeKind::IdentifierExpression:
+                PushValue(node, GetBindingType(static_cast<IdentifierExpression&>(node)));
+                break;
+
+            case ASTNodeKind::BinaryExpression:
+                LeaveBinaryExpression(static_cast<BinaryExpression&>(node));
+                break;
+        }
+    }
+
+    void EnterFunction(FunctionDeclaration& decl) {
+        Vector<const Type*> paramTypes;
+        Vector<const Type*>& scope = m_Scopes.emplace_back();
+        for (const auto& param : decl.GetParameters()) {
+            const Type* type = ResolveTypeName(param.type, decl);
+            paramTypes.push_back(type);
+            scope.push_back(type);
+        }
+
+        const Type* returnType = ResolveTypeName(decl.GetReturnType(), decl);
+        m_NodeTypes[&decl] = m_Types.GetFunction(paramTypes, returnType);
+    }
+
+    void LeaveBinaryExpression(BinaryExpression& expr) {
+        const Type* right = PopValue();
+        const Type* left = PopValue();
+        const Type* error = m_Types.GetError();
+        const Type* untyped = m_Types.GetUntypedInteger();
+
+        if (left == untyped && right != untyped && right->IsInteger()) {
+            left = Settle(expr.GetLeft(), right);
+        } else if (right == untyped && left != untyped && left->IsInteger()) {
+            right = Settle(expr.GetRight(), left);
+        } else if (left == untyped && right == untyped && IsComparison(expr.GetOperator())) {
+            left = SettleDefault(expr.GetLeft(), left);
+            right = SettleDefault(expr.GetRight(), right);
+        }
+
+        if (left == error || right == error) {
+            PushValue(expr, error);
+        } else if (left != right) {
+            m_Errors.push_back(String("mismatched operand types ") + left->name + " and " + right->name +
+                               " for operator " + GetTokenName(expr.GetOperator()));
+            PushValue(expr, error);
+        } else if (!left->IsInteger()) {
+            m_Errors.push_back(String("operator ") + GetTokenName(expr.GetOperator()) +
+                               " is not defined for " + left->name);
+            PushValue(expr, error);
+        } else if (IsComparison(expr.GetOperator())) {
+            PushValue(expr, m_Types.Lookup("bool"));
+        } else {
+            PushValue(expr, left);
+        }
+    }
+
+    // Gives an untyped literal expression its type, on every node of it
+    const Type* Settle(const ASTNodeRef& expr, const Type* type) {
+        ASTWalker::ForEachNode(expr, [&](ASTNode& node) {
+            m_NodeTypes[&node] = type;
+            if (node.GetKind() != ASTNodeKind::IntegerLiteralExpression) {
+                return;
+            }
+            auto& literal = static_cast<IntegerLiteralExpression&>(node);
+            literal.GetType().name = type->name;
+            if (!FitsIn(literal.GetValue(), *type)) {
+                m_Errors.push_back("literal " + String(std::to_string(literal.GetValue()).c_str()) +
+                                   " does not fit in " + type->name);
+            }
+        });
+        return type;
+    }
+
+    const Type* SettleDefault(const ASTNodeRef& expr, const Type* type) {
+        return type == m_Types.GetUntypedInteger() ? Settle(expr, m_Types.Lookup("i32")) : type;
+    }
+
+    static bool FitsIn(int value, const Type& type) {
+        if (type.bitWidth >= 32) {
+            return type.isSigned || value >= 0;
+        }
+        const int64_t max = type.isSigned ? (int64_t(1) << (type.bitWidth - 1)) - 1 : (int64_t(1) << type.bitWidth) - 1;
+        const int64_t min = type.isSigned ? -max - 1 : 0;
+        return value >= min && value <= max;
+    }
+
+    static bool IsComparison(TokenType op) {
+        return op == TokenType::LESS || op == TokenType::GREATER;
+    }
+
+    const Type* ResolveTypeName(const String& name, const FunctionDeclaration& decl) {
+        if (const Type* type = m_Types.Lookup(name)) {
+            return type;
+        }
+        m_Errors.push_back("unknown type " + name + " in signature of fn " + decl.GetName());
+        return m_Types.GetError();
+    }
+
+    // Unresolved names were already reported by NameResolver
+    const Type* GetBindingType(const IdentifierExpression& ident) const {
+        const NameBinding& binding = ident.GetBinding();
+        const int scopeIndex = (int)m_Scopes.size() - 1 - binding.depth;
+        if (binding.kind == NameBinding::Kind::Unresolved || scopeIndex < 0) {
+            return m_Types.GetError();
+        }
+
+        const auto& scope = m_Scopes[scopeIndex];
+        if (binding.slot >= (int)scope.size()) {
+            return m_Types.GetError();
+        }
+        return scope[binding.slot];
+    }
+
+    void PushValue(const ASTNode& node, const Type* type) {
+        m_NodeTypes[&node] = type;
+        m_Values.push_back(type);
+    }
+
+    const Type* PopValue() {
+        if (m_Values.empty()) {
+            return m_Types.GetError();
+        }
+        const Type* type = m_Values.back();
+        m_Values.pop_back();
+        return type;
+    }
+
+    TypeTable& m_Types;
+    Vector<Vector<const Type*>> m_Scopes;
+    Vector<const Type*> m_Values;
+    HashMap<const ASTNode*, const Type*> m_NodeTypes;
+    Vector<String> m_Errors;
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "CommonTypes.h"
+
+#include <deque>
+
+#define BUILTIN_TYPE_LIST(MACRO)      \
+    MACRO("i8", Integer, 8, true)     \
+    MACRO("i16", Integer, 16, true)   \
+    MACRO("i32", Integer, 32, true)   \
+    MACRO("i64", Integer, 64, true)   \
+    MACRO("u8", Integer, 8, false)    \
+    MACRO("u16", Integer, 16, false)  \
+    MACRO("u32", Integer, 32, false)  \
+    MACRO("u64", Integer, 64, false)  \
+    MACRO("bool", Bool, 1, false)     \
+    MACRO("String", String, 0, false)
+
+struct Type {
+    enum class Kind {
+        Error,
+        Integer,
+        Bool,
+        String,
+        Function,
+    };
+
+    Kind kind = Kind::Error;
+    String name;
+    int bitWidth = 0;
+    bool isSigned = false;
+
+    // Function types only
+    Vector<const Type*> parameters;
+    const Type* returnType = nullptr;
+
+    bool IsInteger() const { return kind == Kind::Integer; }
+};
+
+// Hash-consed type representation: every structurally distinct type exists
+// exactly once, so types are compared by pointer. Types live as long as the
+// table and are never freed individually.
+class TypeTable {
+public:
+    TypeTable() {
+        m_Error = &m_Types.emplace_back();
+        m_Error->name = "<error>";
+
+        // Not nameable in source, so it isn't registered under its name
+        m_UntypedInteger = &m_Types.emplace_back();
+        m_UntypedInteger->kind = Type::Kind::Integer;
+        m_UntypedInteger->name = "integer literal";
+
+#define REGISTER_BUILTIN_TYPE(NAME, KIND, BITS, SIGNED) \
+        RegisterBuiltin(NAME, Type::Kind::KIND, BITS, SIGNED);
+
+        BUILTIN_TYPE_LIST(REGISTER_BUILTIN_TYPE)
+#undef REGISTER_BUILTIN_TYPE
+    }
+
+    TypeTable(const TypeTable&) = delete;
+    TypeTable& operator=(const TypeTable&) = delete;
+
+    // Returns nullptr for names that don't denote a type
+    const Type* Lookup(const String& name) const {
+        auto it = m_Named.find(name);
+        return it != m_Named.end() ? it->second : nullptr;
+    }
+
+    const Type* GetError() const {
+        return m_Error;
+    }
+
+    // Type of integer literals until their context decides one
+    const Type* GetUntypedInteger() const {
+        return m_UntypedInteger;
+    }
+
+    // The type TypeChecker recorded on a literal, i32 if it recorded none
+    const Type* GetLiteralType(const String& name) const {
+        const Type* type = name.empty() ? nullptr : Lookup(name);
+        return type ? type : Lookup("i32");
+    }
+
+    const Type* GetFunction(const Vector<const Type*>& parameters, const Type* returnType) {
+        FunctionKey key{ parameters, returnType };
+        auto it = m_Functions.find(key);
+        if (it != m_Functions.end()) {
+            return it->second;
+        }
+
+        Type& type = m_Types.emplace_back();
+        type.kind = Type::Kind::Function;
+        type.parameters = parameters;
+        type.returnType = returnType;
+        type.name = "fn(";
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            if (i > 0) type.name += ", ";
+            type.name += parameters[i]->name;
+        }
+        type.name += ") -> ";
+        type.name += returnType->name;
+
+        m_Functions.emplace(std::move(key), &type);
+        return &type;
+    }
+
+private:
+    struct FunctionKey {
+        Vector<const Type*> parameters;
+        const Type* returnType;
+
+        bool operator==(const FunctionKey& other) const {
+            return returnType == other.returnType && parameters == other.parameters;
+        }
+    };
+
+    struct FunctionKeyHash {
+        size_t operator()(const FunctionKey& key) const {
+            size_t hash = std::hash<const Type*>()(key.returnType);
+            for (const Type* param : key.parameters) {
+                hash = hash * 31 + std::hash<const Type*>()(param);
+            }
+            return hash;
+        }
+    };
+
+    void RegisterBuiltin(const char* name, Type::Kind kind, int bitWidth, bool isSigned) {
+        Type& type = m_Types.emplace_back();
+        type.kind = kind;
+        type.name = name;
+        type.bitWidth = bitWidth;
+        type.isSigned = isSigned;
+        m_Named.emplace(type.name, &type);
+    }
+
+    // deque keeps addresses stable as types are added
+    std::deque<Type> m_Types;
+    Type* m_Error = nullptr;
+    Type* m_UntypedInteger = nullptr;
+    HashMap<String, const Type*> m_Named;
+    std::unordered_map<FunctionKey, const Type*, FunctionKeyHash> m_Functions;
+};
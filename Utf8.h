@@ -0,0 +1,159 @@
+#pragma once
+
+#include "UnicodeTables.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ZIX_UTF8_SSE2 1
+#else
+#define ZIX_UTF8_SSE2 0
+#endif
+
+namespace Utf8
+{
+    // Length of the sequence introduced by a lead byte, 0 for bytes that
+    // can't start one
+    inline int GetSequenceLength(unsigned char lead) {
+        if (lead < 0x80) return 1;
+        if (lead < 0xC2) return 0;
+        if (lead < 0xE0) return 2;
+        if (lead < 0xF0) return 3;
+        if (lead < 0xF5) return 4;
+        return 0;
+    }
+
+    // Strict scalar check of one sequence: no overlongs, no surrogates,
+    // nothing above U+10FFFF. Returns its length, 0 if it is invalid.
+    inline int ValidateSequence(const unsigned char* p, const unsigned char* end) {
+        const int length = GetSequenceLength(p[0]);
+        if (length <= 1 || end - p < length) {
+            return length == 1 ? 1 : 0;
+        }
+
+        // The second byte's range depends on the lead byte (Table 3-7 of
+        // the Unicode standard); later bytes are plain continuations
+        unsigned char low = 0x80, high = 0xBF;
+        switch (p[0]) {
+            case 0xE0: low = 0xA0; break;
+            case 0xED: high = 0x9F; break;
+            case 0xF0: low = 0x90; break;
+            case 0xF4: high = 0x8F; break;
+            default: break;
+        }
+        if (p[1] < low || p[1] > high) {
+            return 0;
+        }
+        for (int i = 2; i < length; ++i) {
+            if ((p[i] & 0xC0) != 0x80) return 0;
+        }
+        return length;
+    }
+
+    // Number of leading bytes of [p, end) that are ASCII. Checks 64 bytes per
+    // iteration with SSE2 (8 bytes with plain words elsewhere), which is the
+    // whole cost of validating typical source files.
+    inline size_t CountAsciiPrefix(const unsigned char* begin, const unsigned char* end) {
+        const unsigned char* p = begin;
+#if ZIX_UTF8_SSE2
+        while (end - p >= 64) {
+            __m128i a = _mm_loadu_si128((const __m128i*)p);
+            __m128i b = _mm_loadu_si128((const __m128i*)(p + 16));
+            __m128i c = _mm_loadu_si128((const __m128i*)(p + 32));
+            __m128i d = _mm_loadu_si128((const __m128i*)(p + 48));
+            __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+            if (_mm_movemask_epi8(any) != 0) break;
+            p += 64;
+        }
+        while (end - p >= 16) {
+            int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+            if (mask != 0) {
+                return (size_t)(p - begin) + __builtin_ctz(mask);
+            }
+            p += 16;
+        }
+#else
+        while (end - p >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            if (word & 0x8080808080808080ull) break;
+            p += 8;
+        }
+#endif
+        while (p < end && *p < 0x80) {
+            ++p;
+        }
+        return (size_t)(p - begin);
+    }
+
+    // Returns the offset of the first byte that isn't part of a valid
+    // sequence, or size if the whole input is valid UTF-8. ASCII runs are
+    // skipped a vector at a time; only non-ASCII sequences are decoded.
+    inline size_t Validate(const char* data, size_t size) {
+        const unsigned char* begin = (const unsigned char*)data;
+        const unsigned char* end = begin + size;
+        const unsigned char* p = begin;
+
+        while (p < end) {
+            p += CountAsciiPrefix(p, end);
+            while (p < end && *p >= 0x80) {
+                const int length = ValidateSequence(p, end);
+                if (length == 0) {
+                    return (size_t)(p - begin);
+                }
+                p += length;
+            }
+        }
+        return size;
+    }
+
+    // Decodes one sequence of already validated input
+    inline int Decode(const char* data, char32_t& codePoint) {
+        const unsigned char* p = (const unsigned char*)data;
+        switch (GetSequenceLength(p[0])) {
+            case 1:
+                codePoint = p[0];
+                return 1;
+            case 2:
+                codePoint = ((p[0] & 0x1Fu) << 6) | (p[1] & 0x3Fu);
+                return 2;
+            case 3:
+                codePoint = ((p[0] & 0x0Fu) << 12) | ((p[1] & 0x3Fu) << 6) | (p[2] & 0x3Fu);
+                return 3;
+            case 4:
+                codePoint = ((p[0] & 0x07u) << 18) | ((p[1] & 0x3Fu) << 12) | ((p[2] & 0x3Fu) << 6) | (p[3] & 0x3Fu);
+                return 4;
+            default:
+                codePoint = 0xFFFD;
+                return 1;
+        }
+    }
+
+    template <size_t N>
+    bool IsInRanges(const UnicodeRange (&ranges)[N], char32_t codePoint) {
+        auto it = std::upper_bound(ranges, ranges + N, codePoint, [](char32_t cp, const UnicodeRange& range) {
+            return cp < range.first;
+        });
+        return it != ranges && codePoint <= (it - 1)->last;
+    }
+
+    // '_' is accepted as a start character, as in C and Rust
+    inline bool IsXIDStart(char32_t codePoint) {
+        if (codePoint < 0x80) {
+            return (codePoint >= 'a' && codePoint <= 'z') || (codePoint >= 'A' && codePoint <= 'Z') || codePoint == '_';
+        }
+        return IsInRanges(XIDStartRanges, codePoint);
+    }
+
+    inline bool IsXIDContinue(char32_t codePoint) {
+        if (codePoint < 0x80) {
+            return (codePoint >= 'a' && codePoint <= 'z') || (codePoint >= 'A' && codePoint <= 'Z') ||
+                   (codePoint >= '0' && codePoint <= '9') || codePoint == '_';
+        }
+        return IsInRanges(XIDContinueRanges, codePoint);
+    }
+}
@@ -0,0 +1,578 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Diagnostics.h"
+#include "FileUtils.h"
+#include "FunctionDeclCollector.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "StructuralHash.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+// On-disk index of the functions declared across a workspace, built from
+// FunctionDeclCollector results. Like a ProgramSnapshot it is an image of
+// 32-bit words that is mmapped and used in place:
+//
+//   IndexHeader
+//   IndexFile[fileCount]            indexed files, sorted by path
+//   IndexSymbol[symbolCount]        sorted by name, then by file
+//   IndexParameter[parameterCount]  parameters of all symbols
+//   char[stringsSize]               NUL-terminated strings, deduplicated
+//
+// Opening only checks the header and section bounds, and lookups validate
+// just the entries they probe, so a query touches a handful of pages no
+// matter how large the index is.
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t size;
+    uint32_t fileCount;
+    uint32_t filesOffset;
+    uint32_t symbolCount;
+    uint32_t symbolsOffset;
+    uint32_t parameterCount;
+    uint32_t parametersOffset;
+    uint32_t stringsSize;
+    uint32_t stringsOffset;
+    uint32_t reserved;
+};
+
+struct IndexFile {
+    uint32_t path;
+    uint32_t pathLength;
+    // Structural hash of the file's text, to tell whether it changed
+    uint32_t textHash[4];
+};
+
+struct IndexSymbol {
+    uint32_t name;
+    uint32_t nameLength;
+    uint32_t file;
+    uint32_t line;
+    uint32_t column;
+    uint32_t returnType;
+    uint32_t returnTypeLength;
+    uint32_t firstParameter;
+    uint32_t parameterCount;
+    uint32_t reserved;
+};
+
+struct IndexParameter {
+    uint32_t name;
+    uint32_t nameLength;
+    uint32_t type;
+    uint32_t typeLength;
+};
+
+// Half-open range of symbol indices
+struct IndexRange {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+
+    bool IsEmpty() const {
+        return begin >= end;
+    }
+};
+
+inline constexpr char IndexMagic[8] = { 'Z', 'I', 'X', 'I', 'N', 'D', 'X', '\0' };
+inline constexpr uint32_t IndexVersion = 1;
+inline constexpr uint32_t IndexByteOrder = 0x01020304;
+
+// Read-only view of an index in memory, usually a mapping of the file
+class WorkspaceIndex {
+public:
+    bool Map(const char* path, String& error) {
+        if (!m_Mapping.Map(path)) {
+            error = String("could not map ") + path;
+            return false;
+        }
+        return Open(m_Mapping.GetData(), m_Mapping.GetSize(), error);
+    }
+
+    bool Open(const void* data, size_t size, String& error) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        if (size < sizeof(IndexHeader) || (uintptr_t)bytes % alignof(IndexHeader) != 0) {
+            error = "index is truncated or misaligned";
+            return false;
+        }
+
+        const IndexHeader& header = *(const IndexHeader*)bytes;
+        if (std::memcmp(header.magic, IndexMagic, sizeof(header.magic)) != 0) {
+            error = "not a zix index";
+            return false;
+        }
+        if (header.version != IndexVersion || header.byteOrder != IndexByteOrder) {
+            error = "index was written by an incompatible version or byte order";
+            return false;
+        }
+        if (header.size != size ||
+            !IsSection(header.filesOffset, header.fileCount, sizeof(IndexFile), size) ||
+            !IsSection(header.symbolsOffset, header.symbolCount, sizeof(IndexSymbol), size) ||
+            !IsSection(header.parametersOffset, header.parameterCount, sizeof(IndexParameter), size) ||
+            !IsSection(header.stringsOffset, header.stringsSize, 1, size)) {
+            error = "index sections are out of bounds";
+            return false;
+        }
+
+        m_Header = &header;
+        m_Files = (const IndexFile*)(bytes + header.filesOffset);
+        m_Symbols = (const IndexSymbol*)(bytes + header.symbolsOffset);
+        m_Parameters = (const IndexParameter*)(bytes + header.parametersOffset);
+        m_Strings = (const char*)(bytes + header.stringsOffset);
+        return true;
+    }
+
+    uint32_t GetFileCount() const {
+        return m_Header ? m_Header->fileCount : 0;
+    }
+
+    uint32_t GetSymbolCount() const {
+        return m_Header ? m_Header->symbolCount : 0;
+    }
+
+    // nullptr if index is out of range or the entry is corrupt
+    const IndexFile* GetFile(uint32_t index) const {
+        if (index >= GetFileCount() || !IsString(m_Files[index].path, m_Files[index].pathLength)) {
+            return nullptr;
+        }
+        return &m_Files[index];
+    }
+
+    const IndexSymbol* GetSymbol(uint32_t index) const {
+        if (index >= GetSymbolCount() || !IsValidSymbol(m_Symbols[index])) {
+            return nullptr;
+        }
+        return &m_Symbols[index];
+    }
+
+    std::string_view GetPath(const IndexFile& file) const {
+        return std::string_view(m_Strings + file.path, file.pathLength);
+    }
+
+    std::string_view GetName(const IndexSymbol& symbol) const {
+        return std::string_view(m_Strings + symbol.name, symbol.nameLength);
+    }
+
+    std::string_view GetReturnType(const IndexSymbol& symbol) const {
+        return std::string_view(m_Strings + symbol.returnType, symbol.returnTypeLength);
+    }
+
+    // Empty if the symbol's file entry is corrupt
+    std::string_view GetPath(const IndexSymbol& symbol) const {
+        const IndexFile* file = GetFile(symbol.file);
+        return file ? GetPath(*file) : std::string_view();
+    }
+
+    // Parameter strings aren't covered by Open(), so they are checked here
+    bool GetParameter(const IndexSymbol& symbol, uint32_t index, std::string_view& name, std::string_view& type) const {
+        if (index >= symbol.parameterCount) {
+            return false;
+        }
+        const IndexParameter& parameter = m_Parameters[symbol.firstParameter + index];
+        if (!IsString(parameter.name, parameter.nameLength) || !IsString(parameter.type, parameter.typeLength)) {
+            return false;
+        }
+        name = std::string_view(m_Strings + parameter.name, parameter.nameLength);
+        type = std::string_view(m_Strings + parameter.type, parameter.typeLength);
+        return true;
+    }
+
+    // Binary search over paths; nullptr if the file isn't indexed
+    const IndexFile* FindFile(std::string_view path, uint32_t* index = nullptr) const {
+        uint32_t low = 0, high = GetFileCount();
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            const IndexFile* file = GetFile(mid);
+            if (!file) {
+                return nullptr;
+            }
+            const std::string_view probe = GetPath(*file);
+            if (probe < path) {
+                low = mid + 1;
+            } else if (path < probe) {
+                high = mid;
+            } else {
+                if (index) *index = mid;
+                return file;
+            }
+        }
+        return nullptr;
+    }
+
+    // Every declaration of name, one per file that declares it
+    IndexRange FindExact(std::string_view name) const {
+        IndexRange range;
+        if (!LowerBound(name, false, range.begin) || !LowerBound(name, true, range.end)) {
+            return IndexRange{};
+        }
+        return range;
+    }
+
+    // Every symbol whose name starts with prefix
+    IndexRange FindPrefix(std::string_view prefix) const {
+        IndexRange range;
+        if (!LowerBound(prefix, false, range.begin)) {
+            return IndexRange{};
+        }
+        // Names sharing the prefix are contiguous from begin on, so the end
+        // is found by a second search that compares only the prefix
+        uint32_t low = range.begin, high = GetSymbolCount();
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            const IndexSymbol* symbol = GetSymbol(mid);
+            if (!symbol) {
+                return IndexRange{};
+            }
+            if (GetName(*symbol).substr(0, prefix.size()) == prefix) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        range.end = low;
+        return range;
+    }
+
+private:
+    // First symbol whose name is >= name, or > name if after is set.
+    // false if the search ran into a corrupt entry.
+    bool LowerBound(std::string_view name, bool after, uint32_t& result) const {
+        uint32_t low = 0, high = GetSymbolCount();
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+            const IndexSymbol* symbol = GetSymbol(mid);
+            if (!symbol) {
+                return false;
+            }
+            const std::string_view probe = GetName(*symbol);
+            if (probe < name || (after && probe == name)) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        result = low;
+        return true;
+    }
+
+    static bool IsSection(uint32_t offset, uint32_t count, size_t elementSize, size_t size) {
+        return offset % 4 == 0 && offset <= size && (uint64_t)count * elementSize <= size - offset;
+    }
+
+    bool IsString(uint32_t offset, uint32_t length) const {
+        return offset < m_Header->stringsSize && length < m_Header->stringsSize - offset &&
+               m_Strings[offset + length] == '\0';
+    }
+
+    bool IsValidSymbol(const IndexSymbol& symbol) const {
+        const uint32_t parameterCount = m_Header->parameterCount;
+        return IsString(symbol.name, symbol.nameLength) && IsString(symbol.returnType, symbol.returnTypeLength) &&
+               symbol.firstParameter <= parameterCount &&
+               symbol.parameterCount <= parameterCount - symbol.firstParameter;
+    }
+
+    FileUtils::MappedFile m_Mapping;
+    const IndexHeader* m_Header = nullptr;
+    const IndexFile* m_Files = nullptr;
+    const IndexSymbol* m_Symbols = nullptr;
+    const IndexParameter* m_Parameters = nullptr;
+    const char* m_Strings = nullptr;
+};
+
+// Brings an index file up to date with a set of changed files. Files whose
+// text hashes the same as before, and indexed files that weren't passed
+// in, are carried over from the old index without being parsed; files that
+// can no longer be read are dropped. Paths are normalized first, so a file
+// is one entry however it is named. The new index is written next to the
+// old one and renamed over it, so readers never see a partial file.
+class WorkspaceIndexBuilder {
+public:
+    struct Stats {
+        uint32_t filesParsed = 0;
+        uint32_t filesReused = 0;
+        uint32_t filesRemoved = 0;
+        uint32_t symbols = 0;
+    };
+
+    bool Update(const char* indexPath, const Vector<const char*>& changedFiles, String& error) {
+        TRACE_SCOPE_FILE("WorkspaceIndexBuilder", indexPath);
+        WorkspaceIndex old;
+        String openError;
+        const bool hasOld = old.Map(indexPath, openError);
+
+        // New file index for each old file that is carried over
+        Vector<uint32_t> carried(old.GetFileCount(), UINT32_MAX);
+        HashSet<std::string_view> changed;
+        // Reserved up front: entries and the set point into the strings
+        m_Paths.reserve(changedFiles.size());
+        for (const char* name : changedFiles) {
+            const String& path = m_Paths.emplace_back(NormalizePath(name));
+            if (!changed.insert(path).second) {
+                m_Paths.pop_back();
+                continue;
+            }
+            uint32_t oldIndex = 0;
+            const IndexFile* previous = hasOld ? old.FindFile(path, &oldIndex) : nullptr;
+            char* text = FileUtils::ReadFile(path.c_str());
+            if (!text) {
+                if (previous) {
+                    ++m_Stats.filesRemoved;
+                }
+                continue;
+            }
+
+            const std::string_view source(text);
+            StructuralHasher hasher(0);
+            hasher.Add(source);
+            const StructuralHash hash = hasher.Finish();
+            if (previous && ToHash(previous->textHash) == hash) {
+                carried[oldIndex] = AddFile(old.GetPath(*previous), hash);
+                ++m_Stats.filesReused;
+            } else {
+                AddParsedFile(path.c_str(), source, hash);
+                ++m_Stats.filesParsed;
+            }
+            delete[] text;
+        }
+
+        for (uint32_t i = 0; i < old.GetFileCount(); ++i) {
+            const IndexFile* file = old.GetFile(i);
+            if (file && !changed.count(old.GetPath(*file))) {
+                carried[i] = AddFile(old.GetPath(*file), ToHash(file->textHash));
+                ++m_Stats.filesReused;
+            }
+        }
+        CarryOverSymbols(old, carried);
+
+        m_Stats.symbols = (uint32_t)m_Symbols.size();
+        const Vector<unsigned char> image = Write();
+
+        // The old mapping stays valid until the rename replaces its file
+        const String temporaryPath = String(indexPath) + ".tmp";
+        FILE* file = fopen(temporaryPath.c_str(), "wb");
+        if (!file) {
+            error = "could not open " + temporaryPath;
+            return false;
+        }
+        const bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+        if (fclose(file) != 0 || !written || std::rename(temporaryPath.c_str(), indexPath) != 0) {
+            std::remove(temporaryPath.c_str());
+            error = String("could not write ") + indexPath;
+            return false;
+        }
+        return true;
+    }
+
+    const Stats& GetStats() const {
+        return m_Stats;
+    }
+
+    void DumpStats(std::ostream& out = std::cerr) const {
+        out << m_Stats.filesParsed << " files parsed, " << m_Stats.filesReused << " reused, "
+            << m_Stats.filesRemoved << " removed, " << m_Stats.symbols << " symbols\n";
+    }
+
+private:
+    // Strings point into the old mapping, the parsed ASTs or m_Paths, all
+    // of which outlive Write()
+    struct FileEntry {
+        std::string_view path;
+        StructuralHash textHash;
+    };
+
+    struct SymbolEntry {
+        std::string_view name;
+        std::string_view returnType;
+        uint32_t file;
+        Location location;
+        uint32_t firstParameter;
+        uint32_t parameterCount;
+    };
+
+    struct ParameterEntry {
+        std::string_view name;
+        std::string_view type;
+    };
+
+    // The file's canonical absolute path, or the lexically normal form of
+    // the given one if that can't be worked out
+    static String NormalizePath(const char* path) {
+        std::error_code error;
+        std::filesystem::path normal = std::filesystem::weakly_canonical(path, error);
+        if (error) {
+            normal = std::filesystem::path(path).lexically_normal();
+        }
+        return String(normal.c_str());
+    }
+
+    static StructuralHash ToHash(const uint32_t (&words)[4]) {
+        return StructuralHash{ words[0] | (uint64_t)words[1] << 32, words[2] | (uint64_t)words[3] << 32 };
+    }
+
+    uint32_t AddFile(std::string_view path, const StructuralHash& hash) {
+        m_Files.push_back(FileEntry{ path, hash });
+        return (uint32_t)m_Files.size() - 1;
+    }
+
+    void AddParsedFile(const char* path, std::string_view source, const StructuralHash& hash) {
+        const uint32_t fileIndex = AddFile(path, hash);
+
+        Lexer lexer(path, source);
+        DiagnosticEngine diagnostics;
+        auto tokenized = Tokenize(lexer, diagnostics);
+        if (!tokenized.isOk()) {
+            return;
+        }
+        ASTNodeRef root = Parse(std::move(tokenized).unwrap(), diagnostics);
+        if (!root) {
+            return;
+        }
+
+        FunctionSymbolTable functions;
+        root->Accept(FunctionDeclCollector(functions, path));
+        functions.ForEach([&](const String&, const FunctionDeclMetaData& meta) {
+            SymbolEntry symbol{ meta.declaration->GetName(), meta.GetReturnType(), fileIndex, meta.GetLocation(),
+                                (uint32_t)m_Parameters.size(), (uint32_t)meta.GetParameters().size() };
+            for (const auto& parameter : meta.GetParameters()) {
+                m_Parameters.push_back(ParameterEntry{ parameter.name, parameter.type });
+            }
+            m_Symbols.push_back(symbol);
+        });
+        m_Roots.push_back(root);
+    }
+
+    // One pass over the old symbols, keeping those of carried files
+    void CarryOverSymbols(const WorkspaceIndex& old, const Vector<uint32_t>& carried) {
+        for (uint32_t i = 0; i < old.GetSymbolCount(); ++i) {
+            const IndexSymbol* symbol = old.GetSymbol(i);
+            if (!symbol || symbol->file >= carried.size() || carried[symbol->file] == UINT32_MAX) {
+                continue;
+            }
+            SymbolEntry entry{ old.GetName(*symbol), old.GetReturnType(*symbol), carried[symbol->file],
+                               Location{ (int)symbol->line, (int)symbol->column },
+                               (uint32_t)m_Parameters.size(), 0 };
+            std::string_view name, type;
+            for (uint32_t p = 0; old.GetParameter(*symbol, p, name, type); ++p) {
+                m_Parameters.push_back(ParameterEntry{ name, type });
+                ++entry.parameterCount;
+            }
+            m_Symbols.push_back(entry);
+        }
+    }
+
+    Vector<unsigned char> Write() {
+        // Files sorted by path, then symbols by name and file path
+        Vector<uint32_t> fileOrder(m_Files.size());
+        for (uint32_t i = 0; i < fileOrder.size(); ++i) {
+            fileOrder[i] = i;
+        }
+        std::sort(fileOrder.begin(), fileOrder.end(), [&](uint32_t a, uint32_t b) {
+            return m_Files[a].path < m_Files[b].path;
+        });
+        Vector<uint32_t> fileRank(m_Files.size());
+        for (uint32_t i = 0; i < fileOrder.size(); ++i) {
+            fileRank[fileOrder[i]] = i;
+        }
+        std::sort(m_Symbols.begin(), m_Symbols.end(), [&](const SymbolEntry& a, const SymbolEntry& b) {
+            if (a.name != b.name) {
+                return a.name < b.name;
+            }
+            return fileRank[a.file] < fileRank[b.file];
+        });
+
+        Vector<IndexFile> files;
+        files.reserve(m_Files.size());
+        for (uint32_t index : fileOrder) {
+            const FileEntry& entry = m_Files[index];
+            const StructuralHash& hash = entry.textHash;
+            files.push_back(IndexFile{ InternString(entry.path), (uint32_t)entry.path.size(),
+                                       { (uint32_t)hash.low, (uint32_t)(hash.low >> 32),
+                                         (uint32_t)hash.high, (uint32_t)(hash.high >> 32) } });
+        }
+
+        Vector<IndexSymbol> symbols;
+        Vector<IndexParameter> parameters;
+        symbols.reserve(m_Symbols.size());
+        parameters.reserve(m_Parameters.size());
+        for (const SymbolEntry& entry : m_Symbols) {
+            IndexSymbol symbol = {};
+            symbol.name = InternString(entry.name);
+            symbol.nameLength = (uint32_t)entry.name.size();
+            symbol.file = fileRank[entry.file];
+            symbol.line = (uint32_t)entry.location.line;
+            symbol.column = (uint32_t)entry.location.column;
+            symbol.returnType = InternString(entry.returnType);
+            symbol.returnTypeLength = (uint32_t)entry.returnType.size();
+            symbol.firstParameter = (uint32_t)parameters.size();
+            symbol.parameterCount = entry.parameterCount;
+            for (uint32_t i = 0; i < entry.parameterCount; ++i) {
+                const ParameterEntry& parameter = m_Parameters[entry.firstParameter + i];
+                parameters.push_back(IndexParameter{ InternString(parameter.name), (uint32_t)parameter.name.size(),
+                                                     InternString(parameter.type), (uint32_t)parameter.type.size() });
+            }
+            symbols.push_back(symbol);
+        }
+
+        IndexHeader header = {};
+        std::memcpy(header.magic, IndexMagic, sizeof(header.magic));
+        header.version = IndexVersion;
+        header.byteOrder = IndexByteOrder;
+        header.fileCount = (uint32_t)files.size();
+        header.symbolCount = (uint32_t)symbols.size();
+        header.parameterCount = (uint32_t)parameters.size();
+        header.stringsSize = (uint32_t)m_Strings.size();
+        while (m_Strings.size() % 4 != 0) {
+            m_Strings.push_back('\0');
+        }
+
+        Vector<unsigned char> blob;
+        blob.reserve(sizeof(header) + files.size() * sizeof(IndexFile) + symbols.size() * sizeof(IndexSymbol) +
+                     parameters.size() * sizeof(IndexParameter) + m_Strings.size());
+        auto Append = [&](const void* data, size_t size) {
+            const size_t offset = blob.size();
+            blob.resize(offset + size);
+            if (size > 0) {
+                std::memcpy(blob.data() + offset, data, size);
+            }
+            return (uint32_t)offset;
+        };
+
+        Append(&header, sizeof(header));
+        header.filesOffset = Append(files.data(), files.size() * sizeof(IndexFile));
+        header.symbolsOffset = Append(symbols.data(), symbols.size() * sizeof(IndexSymbol));
+        header.parametersOffset = Append(parameters.data(), parameters.size() * sizeof(IndexParameter));
+        header.stringsOffset = Append(m_Strings.data(), m_Strings.size());
+        header.size = (uint32_t)blob.size();
+        std::memcpy(blob.data(), &header, sizeof(header));
+        return blob;
+    }
+
+    uint32_t InternString(std::string_view value) {
+        auto [it, inserted] = m_StringOffsets.try_emplace(value, (uint32_t)m_Strings.size());
+        if (inserted) {
+            m_Strings.insert(m_Strings.end(), value.begin(), value.end());
+            m_Strings.push_back('\0');
+        }
+        return it->second;
+    }
+
+    Vector<String> m_Paths;
+    Vector<FileEntry> m_Files;
+    Vector<SymbolEntry> m_Symbols;
+    Vector<ParameterEntry> m_Parameters;
+    Vector<ASTNodeRef> m_Roots;
+
+    Vector<char> m_Strings;
+    HashMap<std::string_view, uint32_t> m_StringOffsets;
+    Stats m_Stats;
+};
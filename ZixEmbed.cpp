@@ -0,0 +1,134 @@
+#include "ZixEmbed.h"
+
+#include "Diagnostics.h"
+#include "FunctionDeclCollector.h"
+#include "Lexer.h"
+#include "NameResolver.h"
+#include "Parser.h"
+#include "Trace.h"
+#include "TypeChecker.h"
+
+#include <cstdio>
+#include <new>
+#include <sstream>
+
+extern "C" zix_program* zix_compile(const char* source, size_t length, const char* filename) {
+    TRACE_SCOPE_FILE("zix_compile", filename);
+    Lexer lexer(filename, std::string_view(source, length));
+    DiagnosticEngine diagnostics;
+    auto tokenized = Tokenize(lexer, diagnostics);
+    ASTNodeRef root = tokenized.isOk() ? Parse(std::move(tokenized).unwrap(), diagnostics) : nullptr;
+    if (!root || diagnostics.HasErrors()) {
+        std::ostringstream message;
+        diagnostics.Dump(message, filename);
+        ZixEmbed::SetLastError(message.str().c_str());
+        return nullptr;
+    }
+
+    // Type checking records each literal's type in the snapshot
+    NameResolver{}.Resolve(root);
+    TypeTable types;
+    TypeChecker(types).Check(root);
+    FunctionSymbolTable functions;
+    root->Accept(FunctionDeclCollector(functions, filename));
+
+    auto* program = new (std::nothrow) zix_program;
+    if (!program) {
+        ZixEmbed::SetLastError("out of memory");
+        return nullptr;
+    }
+    program->image = SnapshotWriter{}.Write(root, functions);
+    program->data = program->image.data();
+    program->size = program->image.size();
+
+    String error;
+    if (!program->snapshot.Open(program->data, program->size, error)) {
+        ZixEmbed::SetLastError(std::move(error));
+        delete program;
+        return nullptr;
+    }
+    return program;
+}
+
+extern "C" zix_program* zix_load(const char* path) {
+    auto* program = new (std::nothrow) zix_program;
+    if (!program) {
+        ZixEmbed::SetLastError("out of memory");
+        return nullptr;
+    }
+    if (!program->mapping.Map(path)) {
+        ZixEmbed::SetLastError(String("could not map ") + path);
+        delete program;
+        return nullptr;
+    }
+    program->data = program->mapping.GetData();
+    program->size = program->mapping.GetSize();
+
+    String error;
+    if (!program->snapshot.Open(program->data, program->size, error)) {
+        ZixEmbed::SetLastError(String(path) + ": " + error);
+        delete program;
+        return nullptr;
+    }
+    return program;
+}
+
+extern "C" int zix_save(const zix_program* program, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        ZixEmbed::SetLastError(String("could not open ") + path);
+        return -1;
+    }
+    const bool written = fwrite(program->data, 1, program->size, file) == program->size;
+    if (fclose(file) != 0 || !written) {
+        ZixEmbed::SetLastError(String("could not write ") + path);
+        return -1;
+    }
+    return 0;
+}
+
+extern "C" int zix_lookup_function(const zix_program* program, const char* name, zix_function* function) {
+    uint32_t index = 0;
+    const SnapshotFunction* entry = program->snapshot.FindFunction(name, &index);
+    if (!entry) {
+        ZixEmbed::SetLastError(String("no function named ") + name);
+        return -1;
+    }
+    ZixEmbed::FillFunction(program, *entry, index, function);
+    return 0;
+}
+
+extern "C" uint32_t zix_function_count(const zix_program* program) {
+    return program->snapshot.GetFunctionCount();
+}
+
+extern "C" int zix_function_at(const zix_program* program, uint32_t index, zix_function* function) {
+    const SnapshotFunction* entry = program->snapshot.GetFunction(index);
+    if (!entry) {
+        ZixEmbed::SetLastError("function index out of range or corrupt");
+        return -1;
+    }
+    ZixEmbed::FillFunction(program, *entry, index, function);
+    return 0;
+}
+
+extern "C" int zix_function_parameter(const zix_program* program, const zix_function* function, uint32_t index,
+                                      zix_parameter* parameter) {
+    const SnapshotFunction* entry = program->snapshot.GetFunction(function->index);
+    std::string_view name, type;
+    if (!entry || !program->snapshot.GetParameter(*entry, index, name, type)) {
+        ZixEmbed::SetLastError("parameter index out of range or corrupt");
+        return -1;
+    }
+    parameter->name = ZixEmbed::ToZixString(name);
+    parameter->type = ZixEmbed::ToZixString(type);
+    return 0;
+}
+
+extern "C" const char* zix_last_error(void) {
+    return ZixEmbed::GetLastError().c_str();
+}
+
+extern "C" void zix_free(zix_program* program) {
+    delete program;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "zix.h"
+
+#include "CommonTypes.h"
+#include "FileUtils.h"
+#include "ProgramSnapshot.h"
+
+// Internals of the C API in zix.h, which ZixEmbed.cpp implements. Compiled
+// programs are turned into the same snapshot image that zix_load maps, so
+// both kinds of program are served by one ProgramSnapshot view.
+struct zix_program {
+    ProgramSnapshot snapshot;
+    Vector<unsigned char> image;
+    FileUtils::MappedFile mapping;
+    const void* data = nullptr;
+    size_t size = 0;
+};
+
+namespace ZixEmbed
+{
+    inline String& GetLastError() {
+        thread_local String error;
+        return error;
+    }
+
+    inline void SetLastError(String error) {
+        GetLastError() = std::move(error);
+    }
+
+    inline zix_string ToZixString(std::string_view text) {
+        return zix_string{ text.data(), text.size() };
+    }
+
+    inline void FillFunction(const zix_program* program, const SnapshotFunction& entry, uint32_t index,
+                             zix_function* function) {
+        function->name = zix_string{ program->snapshot.GetCString(entry.name), entry.nameLength };
+        function->return_type = zix_string{ program->snapshot.GetCString(entry.returnType), entry.returnTypeLength };
+        function->parameter_count = entry.parameterCount;
+        function->index = index;
+    }
+}
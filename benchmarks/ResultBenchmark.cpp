@@ -0,0 +1,119 @@
+// Compares LeanResult with Result: object sizes, and the cost of returning
+// and consuming results of a trivial payload, a heap-owning payload and no
+// payload. Every 16th call fails, about as often as lexing hits an error in
+// practice.
+
+#include "../LeanResult.h"
+#include "../Result.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+enum class BenchError : unsigned char {
+    Failed,
+};
+
+template <>
+struct ResultNiche<BenchError> {
+    static constexpr auto okValue = BenchError(0xff);
+};
+
+using Payload = std::vector<int>;
+
+template <typename R>
+[[gnu::noinline]] R MakeInt(uint32_t i) {
+    if ((i & 15) == 15) return Err(BenchError::Failed);
+    return Ok((int)i);
+}
+
+template <typename R>
+[[gnu::noinline]] R MakePayload(Payload& slot, uint32_t i) {
+    if ((i & 15) == 15) return Err(BenchError::Failed);
+    return Ok(std::move(slot));
+}
+
+template <typename R>
+[[gnu::noinline]] R MakeVoid(uint32_t i) {
+    if ((i & 15) == 15) return Err(BenchError::Failed);
+    return Ok();
+}
+
+// Result::unwrap copies out of a const result; LeanResult moves out of an rvalue
+template <typename T, typename E>
+T Take(Result<T, E>& result) {
+    return result.unwrap();
+}
+
+template <typename T, typename E>
+T Take(LeanResult<T, E>& result) {
+    return std::move(result).unwrap();
+}
+
+template <typename Func>
+double NanosecondsPerCall(uint32_t calls, Func&& func) {
+    const auto start = std::chrono::steady_clock::now();
+    func(calls);
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / calls;
+}
+
+template <typename R>
+double BenchInt(uint32_t calls) {
+    return NanosecondsPerCall(calls, [](uint32_t n) {
+        int64_t sum = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            R result = MakeInt<R>(i);
+            sum += result.isOk() ? Take(result) : -1;
+        }
+        if (sum == 42) std::puts("");
+    });
+}
+
+template <typename R>
+double BenchPayload(uint32_t calls) {
+    return NanosecondsPerCall(calls, [](uint32_t n) {
+        Payload slot(64, 1);
+        int64_t sum = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            R result = MakePayload<R>(slot, i);
+            if (result.isOk()) {
+                slot = Take(result);
+                sum += slot[i & 63];
+            }
+        }
+        if (sum == 42) std::puts("");
+    });
+}
+
+template <typename R>
+double BenchVoid(uint32_t calls) {
+    return NanosecondsPerCall(calls, [](uint32_t n) {
+        uint32_t failures = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            failures += MakeVoid<R>(i).isErr();
+        }
+        if (failures == 42) std::puts("");
+    });
+}
+
+int main(int argc, char** argv) {
+    const uint32_t calls = argc > 1 ? (uint32_t)std::strtoul(argv[1], nullptr, 10) : 20000000;
+
+    std::printf("%-24s %10s %10s\n", "sizeof", "Result", "LeanResult");
+    std::printf("%-24s %10zu %10zu\n", "<int, E>", sizeof(Result<int, BenchError>), sizeof(LeanResult<int, BenchError>));
+    std::printf("%-24s %10zu %10zu\n", "<std::vector<int>, E>", sizeof(Result<Payload, BenchError>),
+                sizeof(LeanResult<Payload, BenchError>));
+    std::printf("%-24s %10zu %10zu\n", "<void, E>", sizeof(Result<void, BenchError>), sizeof(LeanResult<void, BenchError>));
+
+    std::printf("\n%-24s %10s %10s   (%u calls)\n", "ns per call", "Result", "LeanResult", calls);
+    std::printf("%-24s %10.2f %10.2f\n", "<int, E>", BenchInt<Result<int, BenchError>>(calls),
+                BenchInt<LeanResult<int, BenchError>>(calls));
+    std::printf("%-24s %10.2f %10.2f\n", "<std::vector<int>, E>", BenchPayload<Result<Payload, BenchError>>(calls),
+                BenchPayload<LeanResult<Payload, BenchError>>(calls));
+    std::printf("%-24s %10.2f %10.2f\n", "<void, E>", BenchVoid<Result<void, BenchError>>(calls),
+                BenchVoid<LeanResult<void, BenchError>>(calls));
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Compares a tree walk through ASTVisitor (a virtual Accept and a virtual
+// Visit per node) with the same walk through StaticASTVisitor (a switch on
+// the node kind, with Visit calls the compiler can inline). Both visitors
+// count nodes and sum literal values over a tree of about a million nodes,
+// which doesn't fit in cache, and over one of about 16 thousand, which does.
+
+#include "../ASTNode.h"
+#include "../StaticASTVisitor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+// A balanced tree of additions with 2^depth leaves, alternating literals
+// and identifiers
+static ASTNodeRef MakeExpression(int depth, int& leaf) {
+    if (depth == 0) {
+        ++leaf;
+        if (leaf & 1) {
+            return MakeShared<IntegerLiteralExpression>(leaf, LiteralType{});
+        }
+        return MakeShared<IdentifierExpression>(String("x"), NameBinding{});
+    }
+    ASTNodeRef left = MakeExpression(depth - 1, leaf);
+    ASTNodeRef right = MakeExpression(depth - 1, leaf);
+    return MakeShared<BinaryExpression>(TokenType::PLUS, left, right);
+}
+
+// Each declaration holds 2^12 - 1 expression nodes plus itself
+static ASTNodeRef MakeTree(int declarations) {
+    Vector<ASTNodeRef> statements;
+    int leaf = 0;
+    for (int i = 0; i < declarations; ++i) {
+        statements.push_back(MakeShared<VariableDeclaration>(String("v"), MakeExpression(11, leaf)));
+    }
+    return MakeShared<TopStatements>(statements);
+}
+
+struct VirtualCounter final : public ASTVisitor {
+    void Visit(const TopStatements& node) override {
+        ++m_Nodes;
+        for (const auto& statement : node.GetStatements()) {
+            statement->Accept(*this);
+        }
+    }
+
+    void Visit(const VariableDeclaration& node) override {
+        ++m_Nodes;
+        node.GetInitialValue()->Accept(*this);
+    }
+
+    void Visit(const BinaryExpression& node) override {
+        ++m_Nodes;
+        node.GetLeft()->Accept(*this);
+        node.GetRight()->Accept(*this);
+    }
+
+    void Visit(const IntegerLiteralExpression& node) override {
+        ++m_Nodes;
+        m_Sum += node.GetValue();
+    }
+
+    void Visit(const IdentifierExpression&) override {
+        ++m_Nodes;
+    }
+
+    int64_t m_Nodes = 0;
+    int64_t m_Sum = 0;
+};
+
+struct StaticCounter final : public StaticASTVisitor<StaticCounter> {
+    using StaticASTVisitor::Visit;
+
+    void Visit(const TopStatements& node) {
+        ++m_Nodes;
+        for (const auto& statement : node.GetStatements()) {
+            Dispatch(statement);
+        }
+    }
+
+    void Visit(const VariableDeclaration& node) {
+        ++m_Nodes;
+        Dispatch(node.GetInitialValue());
+    }
+
+    void Visit(const BinaryExpression& node) {
+        ++m_Nodes;
+        Dispatch(node.GetLeft());
+        Dispatch(node.GetRight());
+    }
+
+    void Visit(const IntegerLiteralExpression& node) {
+        ++m_Nodes;
+        m_Sum += node.GetValue();
+    }
+
+    void Visit(const IdentifierExpression&) {
+        ++m_Nodes;
+    }
+
+    int64_t m_Nodes = 0;
+    int64_t m_Sum = 0;
+};
+
+// Best of several walks, in ns per node
+template <typename Visitor>
+double NanosecondsPerNode(const ASTNodeRef& root, int walks, int64_t& nodes, int64_t& sum) {
+    double best = 0;
+    for (int i = 0; i < walks; ++i) {
+        Visitor visitor;
+        const auto start = std::chrono::steady_clock::now();
+        if constexpr (std::is_base_of_v<ASTVisitor, Visitor>) {
+            root->Accept(visitor);
+        } else {
+            visitor.Dispatch(root);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        const double perNode = elapsed.count() / visitor.m_Nodes;
+        best = i == 0 ? perNode : std::min(best, perNode);
+        nodes = visitor.m_Nodes;
+        sum = visitor.m_Sum;
+    }
+    return best;
+}
+
+static bool Compare(int declarations, int walks) {
+    const ASTNodeRef root = MakeTree(declarations);
+
+    int64_t virtualNodes = 0, virtualSum = 0, staticNodes = 0, staticSum = 0;
+    const double virtualTime = NanosecondsPerNode<VirtualCounter>(root, walks, virtualNodes, virtualSum);
+    const double staticTime = NanosecondsPerNode<StaticCounter>(root, walks, staticNodes, staticSum);
+    if (virtualNodes != staticNodes || virtualSum != staticSum) {
+        std::fprintf(stderr, "visitors disagree: %lld/%lld nodes\n", (long long)virtualNodes, (long long)staticNodes);
+        return false;
+    }
+
+    std::printf("%lld nodes, best of %d walks\n", (long long)staticNodes, walks);
+    std::printf("  %-20s %8.2f ns per node\n", "ASTVisitor", virtualTime);
+    std::printf("  %-20s %8.2f ns per node\n", "StaticASTVisitor", staticTime);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const int walks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+    return Compare(256, walks) && Compare(4, walks * 64) ? 0 : 1;
+}
@@ -1,26 +1,491 @@
 #include <iostream>
+#include <fstream>
 #include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
 #include "Result.h"
 #include "Lexer.h"
 #include "Utils.h"
 #include "ASTNode.h"
 #include "Parser.h"
 #include "JSONSerializerVisitor.h"
+#include "FunctionDeclCollector.h"
+#include "NameResolver.h"
+#include "TypeChecker.h"
+#include "CommonSubexpressionEliminator.h"
+#include "DeadCodeEliminator.h"
+#include "LoopInvariantHoister.h"
+#include "IRBuilder.h"
+#include "IRPassManager.h"
+#include "CEmitterVisitor.h"
+#include "TokenFormatter.h"
+#include "CompilerQueries.h"
+#include "StaticFrontEnd.h"
+#include "ZixEmbed.h"
+#include "PipelinedFrontEnd.h"
+#include "ParallelJSONSerializer.h"
+#include "JSONASTLoader.h"
+#include "WorkspaceIndex.h"
+#include "Trace.h"
 
 #include "CommonTypes.h"
 
-int main() {
-    Lexer lexer("./program.zix");
+struct Options {
+    const char* filename = "./program.zix";
+    Vector<const char*> inputFiles;
+    const char* traceFile = nullptr;
+    bool memStats = false;
+    bool optimize = false;
+    bool emitIR = false;
+    const char* cOutputFile = nullptr;
+    Vector<String> entryPoints;  // --entry=, repeatable; main if none given
+    bool format = false;
+    bool queryStats = false;
+    bool embedded = false;
+    bool pipeline = false;
+    int jsonThreads = 1;  // 0 uses every core
+    const char* saveSnapshotFile = nullptr;
+    const char* loadSnapshotFile = nullptr;
+    const char* loadJSONFile = nullptr;
+    const char* indexFile = nullptr;
+    const char* lookupName = nullptr;
+    const char* lookupPrefix = nullptr;
+};
 
-    std::cout << "Program:\n";
-    std::cout << lexer.GetStream() << std::endl;
-
-    std::cout << "Tokens:\n";
-    auto tokens = Tokenize(lexer).expect("Could not tokenize program");
-    PrintTokens(tokens);
+// Lexed and parsed at compile time; --embedded prints its AST
+ZIX_STATIC_PROGRAM(EmbeddedProgram, R"zix(
+fn sum(n: i32) -> i32 {
+    let total = 0;
+    for (let i = 0; i < n; i = i + 1) {
+        let term = total + i * (n - i);
+    }
+}
+)zix");
 
-    ASTNodeRef astRoot = Parse(tokens);
-    std::cout << std::endl;
-    astRoot->Accept(JSONSerializerVisitor{});
+static Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--trace=", STR_LIT_LEN("--trace=")) == 0) {
+            options.traceFile = arg + STR_LIT_LEN("--trace=");
+        } else if (std::strcmp(arg, "--mem-stats") == 0) {
+            options.memStats = true;
+        } else if (std::strcmp(arg, "-O") == 0) {
+            options.optimize = true;
+        } else if (std::strcmp(arg, "--fmt") == 0) {
+            options.format = true;
+        } else if (std::strncmp(arg, "--save-snapshot=", STR_LIT_LEN("--save-snapshot=")) == 0) {
+            options.saveSnapshotFile = arg + STR_LIT_LEN("--save-snapshot=");
+        } else if (std::strncmp(arg, "--load-snapshot=", STR_LIT_LEN("--load-snapshot=")) == 0) {
+            options.loadSnapshotFile = arg + STR_LIT_LEN("--load-snapshot=");
+        } else if (std::strncmp(arg, "--json-threads=", STR_LIT_LEN("--json-threads=")) == 0) {
+            options.jsonThreads = std::atoi(arg + STR_LIT_LEN("--json-threads="));
+        } else if (std::strncmp(arg, "--load-json=", STR_LIT_LEN("--load-json=")) == 0) {
+            options.loadJSONFile = arg + STR_LIT_LEN("--load-json=");
+        } else if (std::strncmp(arg, "--index=", STR_LIT_LEN("--index=")) == 0) {
+            options.indexFile = arg + STR_LIT_LEN("--index=");
+        } else if (std::strncmp(arg, "--lookup=", STR_LIT_LEN("--lookup=")) == 0) {
+            options.lookupName = arg + STR_LIT_LEN("--lookup=");
+        } else if (std::strncmp(arg, "--lookup-prefix=", STR_LIT_LEN("--lookup-prefix=")) == 0) {
+            options.lookupPrefix = arg + STR_LIT_LEN("--lookup-prefix=");
+        } else if (std::strcmp(arg, "--pipeline") == 0) {
+            options.pipeline = true;
+        } else if (std::strcmp(arg, "--embedded") == 0) {
+            options.embedded = true;
+        } else if (std::strcmp(arg, "--query-stats") == 0) {
+            options.queryStats = true;
+        } else if (std::strcmp(arg, "--emit-ir") == 0) {
+            options.emitIR = true;
+        } else if (std::strncmp(arg, "--emit-c=", STR_LIT_LEN("--emit-c=")) == 0) {
+            options.cOutputFile = arg + STR_LIT_LEN("--emit-c=");
+        } else if (std::strncmp(arg, "--entry=", STR_LIT_LEN("--entry=")) == 0) {
+            options.entryPoints.push_back(arg + STR_LIT_LEN("--entry="));
+        } else {
+            options.filename = arg;
+            options.inputFiles.push_back(arg);
+        }
+    }
+    return options;
 }
 
+int main(int argc, char** argv) {
+    Options options = ParseOptions(argc, argv);
+    if (options.traceFile) {
+        Trace::Enable();
+    }
+
+    // zixfmt: formats the file to stdout straight from the token stream
+    if (options.format) {
+        Lexer lexer(options.filename);
+        if (!lexer.HasStream()) {
+            std::cerr << "Could not read " << options.filename << std::endl;
+            return 1;
+        }
+
+        DiagnosticEngine diagnostics;
+        {
+            BufferedWriter output(stdout);
+            TokenFormatter(output).Format(lexer, diagnostics);
+        }
+        diagnostics.Dump(std::cerr, options.filename);
+        return diagnostics.HasErrors() ? 1 : 0;
+    }
+
+    // Lexes, parses and serializes on three threads at once, printing the
+    // JSON and then the per-stage stall times
+    if (options.pipeline) {
+        Lexer lexer(options.filename);
+        if (!lexer.HasStream()) {
+            std::cerr << "Could not read " << options.filename << std::endl;
+            return 1;
+        }
+
+        PipelinedFrontEnd pipeline(std::cout);
+        const bool lexed = pipeline.Run(lexer);
+        std::cout << std::endl;
+        pipeline.DumpDiagnostics(std::cerr, options.filename);
+        pipeline.DumpStats(std::cerr);
+        if (options.traceFile) {
+            std::ofstream traceOutput(options.traceFile);
+            Trace::Dump(traceOutput);
+        }
+        return lexed ? 0 : 1;
+    }
+
+    // Compiles the file into a snapshot through the embedding API
+    if (options.saveSnapshotFile) {
+        char* text = FileUtils::ReadFile(options.filename);
+        if (!text) {
+            std::cerr << "Could not read " << options.filename << std::endl;
+            return 1;
+        }
+        zix_program* program = zix_compile(text, std::strlen(text), options.filename);
+        delete[] text;
+        if (!program || zix_save(program, options.saveSnapshotFile) != 0) {
+            std::cerr << zix_last_error();
+            zix_free(program);
+            return 1;
+        }
+        zix_free(program);
+        return 0;
+    }
+
+    // Lists the functions of a snapshot and prints its AST
+    if (options.loadSnapshotFile) {
+        zix_program* program = zix_load(options.loadSnapshotFile);
+        if (!program) {
+            std::cerr << zix_last_error() << std::endl;
+            return 1;
+        }
+
+        for (uint32_t i = 0; i < zix_function_count(program); ++i) {
+            zix_function function;
+            if (zix_function_at(program, i, &function) != 0) {
+                std::cerr << zix_last_error() << std::endl;
+                continue;
+            }
+            std::cout << "fn " << function.name.data << "(";
+            for (uint32_t p = 0; p < function.parameter_count; ++p) {
+                zix_parameter parameter;
+                if (zix_function_parameter(program, &function, p, &parameter) == 0) {
+                    std::cout << (p ? ", " : "") << parameter.name.data << ": " << parameter.type.data;
+                }
+            }
+            std::cout << ") -> " << function.return_type.data << std::endl;
+        }
+
+        ASTNodeRef snapshotRoot = program->snapshot.BuildAST();
+        if (!snapshotRoot) {
+            std::cerr << options.loadSnapshotFile << ": snapshot AST is corrupt" << std::endl;
+            zix_free(program);
+            return 1;
+        }
+        snapshotRoot->Accept(JSONSerializerVisitor{});
+        zix_free(program);
+        return 0;
+    }
+
+    // Updates the workspace index with the files on the command line, then
+    // answers --lookup and --lookup-prefix from the mapped index
+    if (options.indexFile) {
+        String error;
+        if (!options.inputFiles.empty()) {
+            WorkspaceIndexBuilder builder;
+            if (!builder.Update(options.indexFile, options.inputFiles, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            builder.DumpStats(std::cerr);
+        }
+        if (!options.lookupName && !options.lookupPrefix) {
+            return 0;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        WorkspaceIndex index;
+        if (!index.Map(options.indexFile, error)) {
+            std::cerr << options.indexFile << ": " << error << std::endl;
+            return 1;
+        }
+        const IndexRange range = options.lookupName ? index.FindExact(options.lookupName)
+                                                    : index.FindPrefix(options.lookupPrefix);
+        const double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        for (uint32_t i = range.begin; i < range.end; ++i) {
+            const IndexSymbol* symbol = index.GetSymbol(i);
+            if (!symbol) {
+                std::cerr << options.indexFile << ": symbol " << i << " is corrupt" << std::endl;
+                continue;
+            }
+            std::cout << "fn " << index.GetName(*symbol) << "(";
+            std::string_view name, type;
+            for (uint32_t p = 0; index.GetParameter(*symbol, p, name, type); ++p) {
+                std::cout << (p ? ", " : "") << name << ": " << type;
+            }
+            std::cout << ") -> " << index.GetReturnType(*symbol) << "  " << index.GetPath(*symbol) << ':'
+                      << symbol->line << ':' << symbol->column << '\n';
+        }
+        std::cerr << (range.IsEmpty() ? 0 : range.end - range.begin) << " matches of " << index.GetSymbolCount()
+                  << " symbols in " << microseconds << " us" << std::endl;
+        return 0;
+    }
+
+    // Rebuilds the AST from a JSON dump and prints it back out, then reports
+    // load throughput next to lexing and parsing the source file again
+    if (options.loadJSONFile) {
+        FileUtils::MappedFile json;
+        if (!json.Map(options.loadJSONFile)) {
+            std::cerr << "Could not read " << options.loadJSONFile << std::endl;
+            return 1;
+        }
+
+        String error;
+        ASTNodeRef jsonRoot;
+        auto start = std::chrono::steady_clock::now();
+        {
+            TRACE_SCOPE_FILE("JSONASTLoader", options.loadJSONFile);
+            jsonRoot = JSONASTLoader{}.Load(std::string_view((const char*)json.GetData(), json.GetSize()), error);
+        }
+        const double loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!jsonRoot) {
+            std::cerr << options.loadJSONFile << ":" << error << std::endl;
+            return 1;
+        }
+        jsonRoot->Accept(JSONSerializerVisitor{});
+        std::cout << std::endl;
+
+        const auto report = [](const char* what, size_t bytes, double milliseconds) {
+            std::cerr << what << ": " << bytes << " bytes in " << milliseconds << " ms ("
+                      << bytes / 1e3 / std::max(milliseconds, 1e-3) << " MB/s)" << std::endl;
+        };
+        report("JSON load", json.GetSize(), loadMilliseconds);
+
+        char* text = FileUtils::ReadFile(options.filename);
+        if (text) {
+            const size_t length = std::strlen(text);
+            start = std::chrono::steady_clock::now();
+            Lexer lexer(options.filename, std::string_view(text, length));
+            DiagnosticEngine diagnostics;
+            auto tokenized = Tokenize(lexer, diagnostics);
+            if (tokenized.isOk()) {
+                Parse(std::move(tokenized).unwrap(), diagnostics);
+            }
+            report("Re-parse", length, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            delete[] text;
+        }
+        if (options.traceFile) {
+            std::ofstream traceOutput(options.traceFile);
+            Trace::Dump(traceOutput);
+        }
+        return 0;
+    }
+
+    if (options.embedded) {
+        ASTNodeRef embeddedRoot = StaticFrontEnd::BuildAST(EmbeddedProgram);
+        NameResolver{}.Resolve(embeddedRoot);
+        TypeTable types;
+        TypeChecker(types).Check(embeddedRoot);
+        embeddedRoot->Accept(JSONSerializerVisitor{});
+        return 0;
+    }
+
+    // Runs the front end through the query database twice, the second time
+    // after setting the same text again, and reports what was re-executed
+    if (options.queryStats) {
+        char* text = FileUtils::ReadFile(options.filename);
+        if (!text) {
+            std::cerr << "Could not read " << options.filename << std::endl;
+            return 1;
+        }
+
+        CompilerDatabase database;
+        const String file = options.filename;
+        for (int pass = 0; pass < 2; ++pass) {
+            TRACE_SCOPE_FILE("CompilerDatabase", options.filename);
+            database.SetSourceText(file, text);
+            for (const auto& signature : *database.GetFunctionSignatures(file)) {
+                database.GetSignature(file, signature.name);
+                database.GetFunctionHash(file, signature.name);
+            }
+            database.DumpStats(std::cerr);
+        }
+
+        size_t unchanged = 0;
+        const auto& signatures = *database.GetFunctionSignatures(file);
+        for (const auto& signature : signatures) {
+            unchanged += database.GetFunctionChangedAt(file, signature.name) < database.GetRevision();
+        }
+        std::cerr << unchanged << " of " << signatures.size() << " functions unchanged since the previous revision\n";
+        database.GetAST(file)->diagnostics.Dump(std::cerr, options.filename);
+        delete[] text;
+        return 0;
+    }
+
+    int exitCode = 0;
+    {
+        Lexer lexer(options.filename);
+        if (!lexer.HasStream()) {
+            std::cerr << "Could not read " << options.filename << std::endl;
+            return 1;
+        }
+
+        std::cout << "Program:\n";
+        std::cout << lexer.GetStream() << std::endl;
+
+        std::cout << "Tokens:\n";
+        DiagnosticEngine diagnostics;
+        auto tokenized = Tokenize(lexer, diagnostics);
+        if (tokenized.isErr()) {
+            diagnostics.Dump(std::cerr, options.filename);
+            return 1;
+        }
+        auto tokens = std::move(tokenized).unwrap();
+        PrintTokens(tokens);
+
+        ASTNodeRef astRoot = Parse(tokens, diagnostics);
+        diagnostics.Dump(std::cerr, options.filename);
+        std::cout << std::endl;
+
+        FunctionSymbolTable functionTable;
+        FunctionDeclCollector declCollector(functionTable, options.filename);
+        {
+            TRACE_SCOPE_FILE("FunctionDeclCollector", options.filename);
+            MEM_STATS_PHASE("FunctionDeclCollector");
+            astRoot->Accept(declCollector);
+        }
+        declCollector.DumpDuplicates();
+
+        NameResolver nameResolver;
+        {
+            TRACE_SCOPE_FILE("NameResolver", options.filename);
+            MEM_STATS_PHASE("NameResolver");
+            nameResolver.Resolve(astRoot);
+        }
+        nameResolver.DumpErrors();
+
+        TypeTable types;
+        TypeChecker typeChecker(types);
+        {
+            TRACE_SCOPE_FILE("TypeChecker", options.filename);
+            MEM_STATS_PHASE("TypeChecker");
+            typeChecker.Check(astRoot);
+        }
+        typeChecker.DumpErrors();
+
+        // Passes and backends assume a well-formed, resolved and typed tree
+        const bool hasErrors = diagnostics.HasErrors() || !nameResolver.GetUndefinedNames().empty() ||
+                               !typeChecker.GetErrors().empty();
+        if (hasErrors) {
+            exitCode = 1;
+        }
+
+        if (options.optimize && !hasErrors) {
+            {
+                TRACE_SCOPE_FILE("LoopInvariantHoister", options.filename);
+                MEM_STATS_PHASE("LoopInvariantHoister");
+                LoopInvariantHoister{}.Run(astRoot);
+            }
+            {
+                TRACE_SCOPE_FILE("DeadCodeEliminator", options.filename);
+                MEM_STATS_PHASE("DeadCodeEliminator");
+                DeadCodeEliminator deadCodeEliminator(options.entryPoints.empty() ? Vector<String>{ "main" }
+                                                                                  : options.entryPoints);
+                deadCodeEliminator.Run(astRoot);
+                deadCodeEliminator.DumpWarnings();
+            }
+            {
+                TRACE_SCOPE_FILE("CommonSubexpressionEliminator", options.filename);
+                MEM_STATS_PHASE("CommonSubexpressionEliminator");
+                CommonSubexpressionEliminator{}.Run(astRoot);
+            }
+            ASTWalker::UpdateStructuralHashes(astRoot);
+        }
+
+        if (options.emitIR && !hasErrors) {
+            IRBuilder irBuilder(types);
+            IRModule module;
+            {
+                TRACE_SCOPE_FILE("IRBuilder", options.filename);
+                MEM_STATS_PHASE("IRBuilder");
+                module = irBuilder.Lower(astRoot);
+            }
+            irBuilder.DumpErrors();
+
+            IRPassManager passManager;
+            if (options.optimize) {
+                passManager.Add("EliminateDeadValues", IRPasses::EliminateDeadValues);
+            }
+            {
+                MEM_STATS_PHASE("IRPassManager");
+                passManager.Run(module);
+            }
+            passManager.DumpTimings();
+
+            IRVerifier verifier;
+            if (!verifier.Verify(module)) {
+                verifier.DumpErrors();
+            }
+            module.Dump(std::cout);
+        }
+
+        if (options.cOutputFile && !hasErrors) {
+            std::ofstream cOutput(options.cOutputFile);
+            CEmitterVisitor emitter(types, cOutput);
+            {
+                TRACE_SCOPE_FILE("CEmitterVisitor", options.filename);
+                MEM_STATS_PHASE("CEmitterVisitor");
+                emitter.Dispatch(astRoot);
+            }
+            emitter.DumpErrors();
+        }
+
+        {
+            TRACE_SCOPE_FILE("JSONSerializerVisitor", options.filename);
+            MEM_STATS_PHASE("JSONSerializerVisitor");
+            if (options.jsonThreads == 1) {
+                astRoot->Accept(JSONSerializerVisitor{});
+            } else {
+                std::cout.flush();
+                if (!ParallelJSONSerializer(STDOUT_FILENO, (unsigned)std::max(options.jsonThreads, 0)).Serialize(astRoot)) {
+                    std::cerr << "Could not write JSON output" << std::endl;
+                    exitCode = 1;
+                }
+            }
+        }
+    }
+
+    if (options.traceFile) {
+        std::ofstream traceOutput(options.traceFile);
+        Trace::Dump(traceOutput);
+    }
+
+    if (options.memStats) {
+        if (ZIX_ENABLE_MEM_STATS) {
+            MemStats::Dump(std::cerr);
+        } else {
+            std::cerr << "--mem-stats requires building with -DZIX_ENABLE_MEM_STATS=1" << std::endl;
+        }
+    }
+    return exitCode;
+}
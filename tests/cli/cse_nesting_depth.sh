@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+# The same expression at different nesting depths must not be merged:
+# every loop increment below still reads the parameter `a`.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+cat > "$workdir/nesting.zix" <<'ZIX'
+fn main(a: i32) -> i32 {
+    let b = a + 1;
+    for (let i = 0; i < b; i = i + a) {
+        let c = a + 1;
+        for (let j = 0; j < c; j = j + a) {
+            let d = a + 1;
+        }
+    }
+}
+ZIX
+
+"$zix" -O --emit-c="$workdir/nesting.c" "$workdir/nesting.zix" > /dev/null
+cc -std=c99 -Wall -Werror -Wno-unused-function -Wno-unused-variable -c "$workdir/nesting.c" -o "$workdir/nesting.o"
+
+param=$(sed -n 's/^int32_t zix_main(int32_t \([A-Za-z0-9_]*\)) {$/\1/p' "$workdir/nesting.c")
+for counter in i j; do
+    if ! grep -q "${counter}_[0-9_]* = zix_add_i32(${counter}_[0-9_]*, $param)" "$workdir/nesting.c"; then
+        echo "increment of $counter does not read $param:"
+        cat "$workdir/nesting.c"
+        exit 1
+    fi
+done
@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+# -O drops functions unreachable from the entry points: main, or the ones
+# named with --entry=. Without any of them every function is kept, with a
+# warning, rather than pruning the whole program.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+functions() {
+    grep -o 'helper\|other\|main' "$1" | sort -u | tr '\n' ' '
+}
+
+expect() {
+    local name=$1 expected=$2 actual
+    actual=$(functions "$workdir/$name.c")
+    if [ "$actual" != "$expected" ]; then
+        echo "$name: expected functions '$expected', got '$actual'"
+        exit 1
+    fi
+}
+
+printf '%s\n' 'fn helper(a: i32) -> i32 { let b = a; }' \
+              'fn other(a: i32) -> i32 { let c = a + 1; }' > "$workdir/library.zix"
+printf '%s\n' 'fn helper(a: i32) -> i32 { let b = a; }' \
+              'fn main(a: i32) -> i32 { let c = a + 1; }' > "$workdir/program.zix"
+
+"$zix" -O --emit-c="$workdir/no_entry.c" "$workdir/library.zix" > /dev/null 2> "$workdir/no_entry.err"
+expect no_entry "helper other "
+grep -q 'Warning: no entry function (main) is declared; keeping every function' "$workdir/no_entry.err"
+
+"$zix" -O --entry=other --emit-c="$workdir/entry_option.c" "$workdir/library.zix" > /dev/null 2> "$workdir/entry_option.err"
+expect entry_option "other "
+if grep -q Warning "$workdir/entry_option.err"; then
+    echo "entry_option: unexpected warning"
+    exit 1
+fi
+
+"$zix" -O --entry=helper --entry=other --emit-c="$workdir/two_entries.c" "$workdir/library.zix" > /dev/null 2>&1
+expect two_entries "helper other "
+
+"$zix" -O --emit-c="$workdir/default_main.c" "$workdir/program.zix" > /dev/null 2>&1
+expect default_main "main "
@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+# Deeply nested blocks are rejected with a diagnostic instead of
+# overflowing the stack; nesting under the limit still compiles.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+# nest DEPTH OPEN: main with DEPTH copies of OPEN inside, then the closers
+nest() {
+    awk -v depth="$1" -v open="$2" 'BEGIN {
+        printf "fn main(a: i32) -> i32 {"
+        for (i = 0; i < depth; ++i) printf " %s", open
+        for (i = 0; i <= depth; ++i) printf " }"
+        printf "\n"
+    }'
+}
+
+nest 20000 'for (let i = 0; i < a; i = i + 1) {' > "$workdir/deep_for.zix"
+nest 20000 'fn f(b: i32) -> i32 {' > "$workdir/deep_fn.zix"
+for name in deep_for deep_fn; do
+    status=0
+    "$zix" "$workdir/$name.zix" > /dev/null 2> "$workdir/$name.err" || status=$?
+    if [ "$status" -ne 1 ] || ! grep -q "blocks nested more than" "$workdir/$name.err"; then
+        echo "$name: expected a nesting diagnostic and exit code 1, got $status"
+        head -c 1000 "$workdir/$name.err"
+        exit 1
+    fi
+done
+
+nest 200 'for (let i = 0; i < a; i = i + 1) {' > "$workdir/shallow.zix"
+"$zix" -O --emit-c="$workdir/shallow.c" "$workdir/shallow.zix" > /dev/null
@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+# Programs with parse, name or type errors make zix exit 1 without running
+# the optimizer or any backend.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+rm -f "$workdir"/*.c
+
+expect_failure() {
+    local name=$1 source=$2
+    printf '%s\n' "$source" > "$workdir/$name.zix"
+    if "$zix" -O --emit-ir --emit-c="$workdir/$name.c" "$workdir/$name.zix" > "$workdir/$name.out" 2>&1; then
+        echo "$name: expected a non-zero exit code"
+        exit 1
+    fi
+    if [ -e "$workdir/$name.c" ]; then
+        echo "$name: C was emitted despite errors"
+        exit 1
+    fi
+}
+
+expect_failure parse_error 'fn main( -> i32 { }'
+expect_failure undefined_name 'let a = b;'
+expect_failure type_error 'fn f(a: Unknown) -> i32 { }'
+
+printf '%s\n' 'let a = 1 + 2;' > "$workdir/valid.zix"
+"$zix" -O --emit-ir --emit-c="$workdir/valid.c" "$workdir/valid.zix" > "$workdir/valid.out" 2>&1
+test -s "$workdir/valid.c"
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# zixfmt keeps every comment: trailing ones stay on their line, the rest
+# get a line of their own. Formatting the output again changes nothing.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+cat > "$workdir/input.zix" <<'ZIX'
+// Header comment
+/* block
+   spanning lines */
+fn main(a: i32) -> i32 {   // opens main
+  let b = a +/* inline */1;// trailing
+        // own line
+  for (let i = 0; i < b; i = i + 1) { let c = i; /* after */ }
+}   // end of main
+let x = 1;
+// last
+ZIX
+
+cat > "$workdir/expected.zix" <<'ZIX'
+// Header comment
+/* block
+   spanning lines */
+fn main(a: i32) -> i32 { // opens main
+    let b = a + /* inline */ 1; // trailing
+    // own line
+    for (let i = 0; i < b; i = i + 1) {
+        let c = i; /* after */
+    }
+} // end of main
+
+let x = 1;
+// last
+ZIX
+
+"$zix" --fmt "$workdir/input.zix" > "$workdir/formatted.zix"
+diff -u "$workdir/expected.zix" "$workdir/formatted.zix"
+
+"$zix" --fmt "$workdir/formatted.zix" > "$workdir/reformatted.zix"
+diff -u "$workdir/formatted.zix" "$workdir/reformatted.zix"
@@ -0,0 +1,18 @@
+#!/usr/bin/env bash
+# zixfmt writes integer literals as spelled, so leading zeros survive and a
+# literal past INT32_MAX isn't turned into a negative number, and
+# formatting the output again changes nothing.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+printf '%s\n' 'let a  =  0042;' 'let b=2147483648;' 'let c = 7+00;' > "$workdir/input.zix"
+printf '%s\n' 'let a = 0042;' 'let b = 2147483648;' 'let c = 7 + 00;' > "$workdir/expected.zix"
+
+"$zix" --fmt "$workdir/input.zix" > "$workdir/formatted.zix"
+diff -u "$workdir/expected.zix" "$workdir/formatted.zix"
+
+"$zix" --fmt "$workdir/formatted.zix" > "$workdir/reformatted.zix"
+diff -u "$workdir/formatted.zix" "$workdir/reformatted.zix"
@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+# --pipeline and a snapshot round trip print the same AST JSON as the
+# serial compile, literal types included.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+cat > "$workdir/program.zix" <<'ZIX'
+let a = 1 + 2;
+fn f(x: u8, y: i64) -> i32 {
+    let b = x + 3;
+    for (let i = y; i < 100; i = i + 1) {
+        let c = i * 2;
+    }
+}
+let d = a < 4;
+ZIX
+
+# The serial compile prints the source and tokens first; the JSON starts
+# at the first line that opens an object
+"$zix" "$workdir/program.zix" | sed -n '/^{/,$p' > "$workdir/serial.json"
+echo >> "$workdir/serial.json"
+if grep -q '"Type": ""' "$workdir/serial.json"; then
+    echo "serial: untyped literal"
+    exit 1
+fi
+
+"$zix" --pipeline "$workdir/program.zix" > "$workdir/pipeline.json" 2> /dev/null
+diff -u "$workdir/serial.json" "$workdir/pipeline.json"
+
+"$zix" --save-snapshot="$workdir/program.snap" "$workdir/program.zix"
+"$zix" --load-snapshot="$workdir/program.snap" | sed -n '/^{/,$p' > "$workdir/snapshot.json"
+echo >> "$workdir/snapshot.json"
+diff -u "$workdir/serial.json" "$workdir/snapshot.json"
+
+if "$zix" --embedded | grep -q '"Type": ""'; then
+    echo "embedded: untyped literal"
+    exit 1
+fi
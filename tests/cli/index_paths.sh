@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+# The workspace index keys files by normalized path: naming an indexed
+# file another way reuses its entry instead of adding a second one.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+rm -rf "$workdir"
+mkdir -p "$workdir/sub"
+cd "$workdir"
+
+printf '%s\n' 'fn gamma(a: i32) -> i32 { }' > a.zix
+printf '%s\n' 'fn delta(b: i32) -> i32 { }' > sub/b.zix
+
+"$zix" --index=ws.idx a.zix sub/b.zix 2> /dev/null
+"$zix" --index=ws.idx ./a.zix sub/../a.zix "$PWD/a.zix" sub/./b.zix 2> update.err
+grep -q '^0 files parsed, 2 reused, 0 removed, 2 symbols$' update.err
+
+"$zix" --index=ws.idx --lookup=gamma > lookup.out 2> /dev/null
+if [ "$(grep -c '^fn gamma' lookup.out)" -ne 1 ]; then
+    echo "gamma is listed more than once:"
+    cat lookup.out
+    exit 1
+fi
+
+# A removed file is dropped whichever way it is named
+rm a.zix
+"$zix" --index=ws.idx ./a.zix 2> remove.err
+grep -q '^0 files parsed, 1 reused, 1 removed, 1 symbols$' remove.err
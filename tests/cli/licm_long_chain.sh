@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+# Loop invariant hoisting handles very long expressions in linear time and
+# bounded stack: an 80000-term chain in a loop body compiles under -O, and
+# the invariant part of the loop condition is still hoisted. The chain's
+# binding is unused, so dead code elimination drops it before output.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+awk -v terms=80000 'BEGIN {
+    printf "fn main(a: i32) -> i32 { for (let i = 0; i < a + 1; i = i + 1) { let s = i"
+    for (t = 0; t < terms; ++t) printf " + 1"
+    printf "; } }\n"
+}' > "$workdir/chain.zix"
+
+"$zix" -O --emit-c="$workdir/chain.c" "$workdir/chain.zix" > /dev/null
+if ! grep -q "(i_[0-9_]* < _24licm0_[0-9_]*)" "$workdir/chain.c"; then
+    echo "invariant loop condition was not hoisted"
+    exit 1
+fi
@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# A body let that shadows a parameter is not hoisted: moved in front of the
+# loop, it would also shadow the parameter the loop condition reads.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+cat > "$workdir/shadow.zix" <<'ZIX'
+fn main(t: i32) -> i32 {
+    for (let i = 0; i < t; i = i + 1) {
+        let t = 5;
+        let w = t + i;
+    }
+}
+ZIX
+
+"$zix" -O --emit-c="$workdir/shadow.c" "$workdir/shadow.zix" > /dev/null
+cc -std=c99 -Wall -Werror -Wno-unused-function -Wno-unused-variable -c "$workdir/shadow.c" -o "$workdir/shadow.o"
+
+param=$(sed -n 's/^int32_t zix_main(int32_t \([A-Za-z0-9_]*\)) {$/\1/p' "$workdir/shadow.c")
+if ! grep -q "(i_[0-9_]* < $param)" "$workdir/shadow.c"; then
+    echo "loop condition does not read the parameter $param:"
+    cat "$workdir/shadow.c"
+    exit 1
+fi
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+# Integer literals take the integer type of the operand or target they meet,
+# default to i32 otherwise, and must fit the type they get.
+set -euo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+cat > "$workdir/widths.zix" <<'ZIX'
+fn widths(a: i64, b: u8, c: u16) -> i64 {
+    let x = a + 1;
+    let y = 2 * b;
+    let z = (1 + 2) * c;
+    let small = b < 10;
+    let n = 7;
+    for (let i = 0; i < 1 + n; i = i + 1) {
+        let d = 1 - a;
+    }
+}
+ZIX
+
+for optimize in "" -O; do
+    "$zix" $optimize --emit-c="$workdir/widths.c" "$workdir/widths.zix" > /dev/null
+    cc -std=c99 -Wall -Werror -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable \
+        -c "$workdir/widths.c" -o "$workdir/widths.o"
+done
+
+"$zix" --emit-c="$workdir/widths.c" "$workdir/widths.zix" > /dev/null
+for expected in \
+    'zix_add_i64(a_1_0, INT64_C(1))' \
+    'zix_mul_u8(UINT8_C(2), b_1_1)' \
+    'zix_mul_u16(zix_add_u16(UINT16_C(1), UINT16_C(2)), c_1_2)' \
+    '(b_1_1 < UINT8_C(10))' \
+    'int32_t n_2_4 = INT32_C(7);' \
+    'zix_sub_i64(INT64_C(1), a_1_0)'; do
+    if ! grep -qF "$expected" "$workdir/widths.c"; then
+        echo "missing: $expected"
+        cat "$workdir/widths.c"
+        exit 1
+    fi
+done
+
+expect_error() {
+    local name=$1 source=$2 message=$3
+    printf '%s\n' "$source" > "$workdir/$name.zix"
+    if "$zix" "$workdir/$name.zix" > /dev/null 2> "$workdir/$name.err"; then
+        echo "$name: expected a type error"
+        exit 1
+    fi
+    if ! grep -qF "$message" "$workdir/$name.err"; then
+        echo "$name: expected \"$message\", got:"
+        cat "$workdir/$name.err"
+        exit 1
+    fi
+}
+
+expect_error out_of_range 'fn f(b: u8) -> u8 { let y = b + 256; }' 'literal 256 does not fit in u8'
+expect_error mixed_widths 'fn f(a: i64, b: u8) -> i64 { let y = a + b; }' 'mismatched operand types i64 and u8'
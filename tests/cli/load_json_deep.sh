@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# --load-json reads a dump nested 50000 levels deep without overflowing
+# the stack. Printing such a tree back is quadratic in its depth, so only
+# the start of the output is read; it is only written once loading worked.
+set -uo pipefail
+
+zix=$1
+workdir=$2
+mkdir -p "$workdir"
+
+literal='{"NodeType":"IntegerLiteralExpression","Value":"1","Type":"i32"}'
+awk -v depth=50000 -v literal="$literal" 'BEGIN {
+    printf "{\"NodeType\":\"TopStatements\",\"Statements\":[{\"NodeType\":\"VariableDeclaration\",\"Name\":\"a\",\"InitialValue\":"
+    for (i = 0; i < depth; ++i) printf "{\"NodeType\":\"BinaryExpression\",\"Operator\":\"PLUS\",\"Left\":"
+    printf "%s", literal
+    for (i = 0; i < depth; ++i) printf ",\"Right\":%s}", literal
+    printf "}]}\n"
+}' > "$workdir/deep.json"
+
+"$zix" --load-json="$workdir/deep.json" /dev/null 2> "$workdir/deep.err" | head -c 4096 > "$workdir/deep.out"
+status=${PIPESTATUS[0]}
+# 141 is SIGPIPE from head closing the pipe
+if [ "$status" -ne 0 ] && [ "$status" -ne 141 ]; then
+    echo "loading failed with status $status"
+    head -c 1000 "$workdir/deep.err"
+    exit 1
+fi
+if ! grep -q '"NodeType": "BinaryExpression"' "$workdir/deep.out"; then
+    echo "no AST was printed"
+    exit 1
+fi
+
+# Errors deep inside are still reported with their position
+sed 's/"PLUS","Left":{"NodeType":"IntegerLiteralExpression"/"PLUS","Left":{"NodeType":"Bogus"/' "$workdir/deep.json" > "$workdir/bad.json"
+if "$zix" --load-json="$workdir/bad.json" /dev/null > /dev/null 2> "$workdir/bad.err"; then
+    echo "a bad node type was accepted"
+    exit 1
+fi
+grep -q 'unknown NodeType' "$workdir/bad.err"
@@ -0,0 +1,67 @@
+/* Drives the zix.h C API from a C host: compiles a program, saves it as a
+ * snapshot, loads the snapshot back and looks functions up in both. */
+
+#include "zix.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char source[] =
+    "fn add(a: i32, b: u8) -> i64 { let c = a; }\n"
+    "fn main(n: i32) -> i32 { for (let i = 0; i < n; i = i + 1) { } }\n";
+
+static int failures = 0;
+
+static void check(int condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s (%s)\n", what, zix_last_error());
+        ++failures;
+    }
+}
+
+static int equals(zix_string string, const char* expected) {
+    return string.length == strlen(expected) && strcmp(string.data, expected) == 0;
+}
+
+static void check_program(const zix_program* program) {
+    zix_function function;
+    zix_parameter parameter;
+
+    check(zix_function_count(program) == 2, "two functions");
+    check(zix_lookup_function(program, "add", &function) == 0, "lookup add");
+    check(equals(function.name, "add"), "name of add");
+    check(equals(function.return_type, "i64"), "return type of add");
+    check(function.parameter_count == 2, "parameter count of add");
+    check(zix_function_parameter(program, &function, 1, &parameter) == 0, "second parameter of add");
+    check(equals(parameter.name, "b") && equals(parameter.type, "u8"), "b: u8");
+    check(zix_function_parameter(program, &function, 2, &parameter) != 0, "no third parameter");
+    check(zix_lookup_function(program, "missing", &function) != 0, "lookup of a missing function fails");
+    check(zix_function_at(program, 1, &function) == 0 && equals(function.name, "main"), "functions in name order");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s SNAPSHOT_PATH\n", argv[0]);
+        return 2;
+    }
+
+    zix_program* compiled = zix_compile(source, strlen(source), "embed.zix");
+    check(compiled != NULL, "compile");
+    if (!compiled) {
+        return 1;
+    }
+    check_program(compiled);
+    check(zix_save(compiled, argv[1]) == 0, "save");
+    zix_free(compiled);
+
+    zix_program* loaded = zix_load(argv[1]);
+    check(loaded != NULL, "load");
+    if (loaded) {
+        check_program(loaded);
+        zix_free(loaded);
+    }
+
+    check(zix_compile("fn (", 4, "broken.zix") == NULL, "compile of a syntax error fails");
+    check(strlen(zix_last_error()) > 0, "syntax error is reported");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+# Usage: run_c_backend_test.sh ZIX CC SOURCE.zix WORKDIR
+#
+# Emits C for SOURCE, then builds it with a generated driver that runs
+# zix_init() and prints every top-level binding. The output must match
+# SOURCE's .expected file.
+set -euo pipefail
+
+zix=$1
+cc=$2
+source=$3
+workdir=$4
+name=$(basename "$source" .zix)
+expected=${source%.zix}.expected
+
+mkdir -p "$workdir"
+emitted=$workdir/$name.c
+driver=$workdir/${name}_driver.c
+binary=$workdir/$name
+
+"$zix" --emit-c="$emitted" "$source" > /dev/null
+
+# Top-level lets are emitted as `static <type> <name>_0_<slot>;`
+{
+    echo "#include <stdio.h>"
+    echo "#include \"$name.c\""
+    echo "int main(void) {"
+    echo "    zix_init();"
+    sed -n 's/^static \([a-z0-9_]*\) \([A-Za-z0-9_]*\);$/\1 \2/p' "$emitted" | while read -r type variable; do
+        case $type in
+            uint*) echo "    printf(\"%s = %llu\\n\", \"$variable\", (unsigned long long)$variable);" ;;
+            *)     echo "    printf(\"%s = %lld\\n\", \"$variable\", (long long)$variable);" ;;
+        esac
+    done
+    echo "    return 0;"
+    echo "}"
+} > "$driver"
+
+"$cc" -std=c99 -O2 -Wall -Werror -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable -o "$binary" "$driver"
+"$binary" | diff -u "$expected" -
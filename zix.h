@@ -0,0 +1,65 @@
+#ifndef ZIX_H
+#define ZIX_H
+
+/* C API for embedding zix. A program comes either from source
+ * (zix_compile) or from a snapshot written by zix_save (zix_load), which
+ * maps the file and needs no lexing, parsing or analysis. Strings returned
+ * through the API point into the program and stay valid until zix_free. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct zix_program zix_program;
+
+typedef struct zix_string {
+    const char* data; /* NUL-terminated */
+    size_t length;
+} zix_string;
+
+typedef struct zix_function {
+    zix_string name;
+    zix_string return_type;
+    uint32_t parameter_count;
+    uint32_t index; /* position in the program's function table */
+} zix_function;
+
+typedef struct zix_parameter {
+    zix_string name;
+    zix_string type;
+} zix_parameter;
+
+/* Lexes, parses and analyzes source. Returns NULL on syntax errors. */
+zix_program* zix_compile(const char* source, size_t length, const char* filename);
+
+/* Maps a snapshot file. Returns NULL if it can't be read or is invalid. */
+zix_program* zix_load(const char* path);
+
+/* Writes the program as a snapshot. Returns 0 on success, -1 on failure. */
+int zix_save(const zix_program* program, const char* path);
+
+/* Returns 0 and fills *function if the program defines name, -1 otherwise. */
+int zix_lookup_function(const zix_program* program, const char* name, zix_function* function);
+
+uint32_t zix_function_count(const zix_program* program);
+
+/* Functions in name order. Returns 0 on success, -1 if index is out of range. */
+int zix_function_at(const zix_program* program, uint32_t index, zix_function* function);
+
+/* Returns 0 on success, -1 if index is out of range or the snapshot is corrupt. */
+int zix_function_parameter(const zix_program* program, const zix_function* function, uint32_t index,
+                           zix_parameter* parameter);
+
+/* Message for the last failed call on this thread, "" if there is none. */
+const char* zix_last_error(void);
+
+void zix_free(zix_program* program);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif